@@ -1,125 +1,455 @@
 // See http://en.wikipedia.org/wiki/Dancing_Links.
+#include <fcntl.h>
 #include <limits.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
 #include "dlx.h"
 
 #define F(i,n) for(int i = 0; i < n; i++)
 
-#define C(i,n,dir) for(cell_ptr i = (n)->dir; i != n; i = i->dir)
+// Cells live in one pool and refer to each other by index. Iterating needs
+// the pool, which by convention is the local variable 'a'.
+#define C(i,n,dir) for(link_t i = a[n].dir; i != (n); i = a[i].dir)
+
+typedef uint32_t link_t;
 
 struct cell_s;
 typedef struct cell_s *cell_ptr;
 struct cell_s {
-    cell_ptr U, D, L, R;
-    int n;
-    union {
-        cell_ptr c;
-        int s;
-    };
+    link_t U, D, L, R;
+    int n;     // Row number, or column number for a header.
+    link_t c;  // Column header.
+    // Nonzero for a cell of a secondary column that several rows may share
+    // as long as they agree on the color. While a column is purified, cells
+    // that agree are set to -1 and its header holds the color.
+    int color;
+    int pad;  // A 32-byte cell never straddles a cache line.
 };
 
 // Some link dance moves.
-static cell_ptr LR_self(cell_ptr c) { return c->L = c->R = c; }
-static cell_ptr UD_self(cell_ptr c) { return c->U = c->D = c; }
+static link_t LR_self(cell_ptr a, link_t c) { return a[c].L = a[c].R = c; }
+static link_t UD_self(cell_ptr a, link_t c) { return a[c].U = a[c].D = c; }
+
+// Built with DLX_STATS, the searches count their updates ("mems") in a
+// per-thread counter: links changed, cells moved, or rows filtered. It costs
+// an add in the innermost loops, so it is left out by default.
+#ifdef DLX_STATS
+static __thread long long mems;
+#define MEMS(k) ((void)(mems += (k)))
+#else
+#define MEMS(k) ((void)0)
+#endif
 
 // Undeletable deletes.
-static cell_ptr LR_delete(cell_ptr c) {
-    return c->L->R = c->R, c->R->L = c->L, c;
+static link_t LR_delete(cell_ptr a, link_t c) {
+    return MEMS(2), a[a[c].L].R = a[c].R, a[a[c].R].L = a[c].L, c;
 }
-static cell_ptr UD_delete(cell_ptr c) {
-    return c->U->D = c->D, c->D->U = c->U, c;
+static link_t UD_delete(cell_ptr a, link_t c) {
+    return MEMS(2), a[a[c].U].D = a[c].D, a[a[c].D].U = a[c].U, c;
 }
 
 // Undelete.
-static cell_ptr UD_restore(cell_ptr c) { return c->U->D = c->D->U = c; }
-static cell_ptr LR_restore(cell_ptr c) { return c->L->R = c->R->L = c; }
+static link_t UD_restore(cell_ptr a, link_t c) {
+    return MEMS(2), a[a[c].U].D = a[a[c].D].U = c;
+}
+static link_t LR_restore(cell_ptr a, link_t c) {
+    return MEMS(2), a[a[c].L].R = a[a[c].R].L = c;
+}
 
 // Insert cell j to the left of cell k.
-static cell_ptr LR_insert(cell_ptr j, cell_ptr k) {
-    return j->L = k->L, j->R = k, k->L = k->L->R = j;
+static link_t LR_insert(cell_ptr a, link_t j, link_t k) {
+    return a[j].L = a[k].L, a[j].R = k, a[k].L = a[a[k].L].R = j;
 }
 
 // Insert cell j above cell k.
-static cell_ptr UD_insert (cell_ptr j, cell_ptr k) {
-    return j->U = k->U, j->D = k, k->U = k->U->D = j;
-}
-
-cell_ptr col_new() {
-    cell_ptr c = malloc(sizeof(*c));
-    UD_self(c)->s = 0;
-    return c;
+static link_t UD_insert(cell_ptr a, link_t j, link_t k) {
+    return a[j].U = a[k].U, a[j].D = k, a[k].U = a[a[k].U].D = j;
 }
 
 struct dlx_s {
     int ctabn, rtabn, ctab_alloc, rtab_alloc;
-    cell_ptr *ctab, *rtab;
-    cell_ptr root;
+    link_t *ctab, *rtab;
+    // Column sizes, indexed by column number. See cover_col().
+    int *S;
+    // Pool of cells. Cell 0 is the root, so a zero entry in 'rtab' can stand
+    // for an empty row.
+    cell_ptr cell;
+    link_t celln, cell_alloc;
+    // Set when cells have been added since the pool was last laid out.
+    int dirty;
+    int strategy;  // How to choose the column to branch on.
+    int row_order;  // How to order the rows of that column.
+    uint64_t seed;
+    int colors;  // Set once any cell has a color.
+    int backend;  // One of DLX_LINKS, DLX_CELLS, DLX_BITS or DLX_AUTO.
+    // Unless every primary column must be covered exactly once: how many more
+    // times each column may be covered, and how many of those are optional.
+    int *bound, *slack;
+    // Rows dlx_reduce() found every solution needs, and picked.
+    int *forced, forcedn;
+    // Inverses of the permutations given to dlx_add_symmetry(), each after
+    // its length.
+    int **sym, symn;
+    // Once dlx_pick_job() has picked a job's rows, the order lex-leader
+    // pruning compared rows in when the job was split off, and its column.
+    int *sym_ord, sym_ordn, sym_col;
+    // While dlx_push() marks are outstanding, every change to the links is
+    // logged here so dlx_pop() can undo it. 'mark' holds log lengths.
+    struct undo_s *undo;
+    int undon, undo_alloc;
+    int *mark, markn;
+    // Statistics of the last search, if dlx_set_stats() asked for them.
+    int stats_on;
+    struct dlx_stats_s stats;
+    // From dlx_set_progress().
+    long long progress_every;
+    void (*progress)(double, long long);
+    // From dlx_set_checkpoint(), and the position dlx_resume() read, which
+    // the next search starts from: rows, how many of them, one of the
+    // RESUME_* states, and the counts of the run that wrote it.
+    char *ckpt;
+    long long ckpt_every;
+    int *replay, replayn, replay_state;
+    long long replay_found, replay_nodes;
 };
 typedef struct dlx_s *dlx_t;
 
+// Changes dlx_pop() knows how to undo.
+enum { UNDO_PICK, UNDO_REMOVE, UNDO_FORCE, UNDO_DROP, UNDO_HEAD, UNDO_SYM };
+struct undo_s {
+    int op, row;
+    link_t x;  // The row's cell, or the column dropped, or the old rtab entry.
+};
+
+static const link_t root = 0;
+
+// Where a checkpoint left its search: at a node it had yet to look at, past
+// one it had reported, or done.
+enum { RESUME_AT, RESUME_PAST, RESUME_DONE };
+static const char *const resume_state[] = { "at", "past", "done" };
+
+static void stats_free(struct dlx_stats_s *st) {
+    free(st->nodes_at);
+    free(st->solutions_at);
+    free(st->seconds_at);
+}
+
+// The splitmix64 generator.
+static uint64_t rng_next(uint64_t *state) {
+    uint64_t x = (*state += 0x9e3779b97f4a7c15ull);
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+    return x ^ (x >> 31);
+}
+
+// Added to the size of a column that may not be chosen. Sizes stay below it.
+enum { INACTIVE = 1 << 29 };
+
+// Returns the index of a fresh cell. May move the pool.
+static link_t cell_new(dlx_t p) {
+    if (p->celln == p->cell_alloc) {
+        p->cell = realloc(p->cell, sizeof(*p->cell) * (p->cell_alloc *= 2));
+    }
+    p->dirty = 1;
+    return p->celln++;
+}
+
+static link_t col_new(dlx_t p) {
+    link_t c = cell_new(p);
+    p->cell[c].color = 0;
+    return UD_self(p->cell, c);
+}
+
 dlx_t dlx_new() {
     dlx_t p = malloc(sizeof(*p));
     p->ctabn = p->rtabn = 0;
     p->ctab_alloc = p->rtab_alloc = 8;
-    p->ctab = malloc(sizeof(cell_ptr) * p->ctab_alloc);
-    p->rtab = malloc(sizeof(cell_ptr) * p->rtab_alloc);
-    p->root = LR_self(col_new());
+    p->ctab = malloc(sizeof(link_t) * p->ctab_alloc);
+    p->S = malloc(sizeof(int) * p->ctab_alloc);
+    p->rtab = malloc(sizeof(link_t) * p->rtab_alloc);
+    p->celln = 0;
+    p->strategy = DLX_MRV;
+    p->row_order = DLX_ORDER_INSERTION;
+    p->seed = 0;
+    p->colors = 0;
+    const char *backend = getenv("DLX_BACKEND");
+    p->backend = DLX_AUTO;
+    if (backend) {
+        if (!strcmp(backend, "links")) p->backend = DLX_LINKS;
+        if (!strcmp(backend, "cells")) p->backend = DLX_CELLS;
+        if (!strcmp(backend, "bits")) p->backend = DLX_BITS;
+    }
+    p->bound = p->slack = 0;
+    p->forced = 0;
+    p->forcedn = 0;
+    p->sym = 0;
+    p->symn = 0;
+    p->sym_ord = 0;
+    p->sym_ordn = 0;
+    p->sym_col = -1;
+    p->ckpt = 0;
+    p->ckpt_every = 0;
+    p->replay = 0;
+    p->replayn = 0;
+    p->undo = 0;
+    p->undon = p->undo_alloc = 0;
+    p->mark = 0;
+    p->markn = 0;
+    p->stats_on = 0;
+    p->progress_every = 0;
+    p->progress = 0;
+    p->stats = (struct dlx_stats_s) { 0 };
+    p->cell_alloc = 64;
+    p->cell = malloc(sizeof(*p->cell) * p->cell_alloc);
+    LR_self(p->cell, col_new(p));
     return p;
 }
 
 void dlx_clear(dlx_t p) {
-    // Elements in the LR list for each row are never covered, thus all cells
-    // can be accessed from the 'rtab' LR lists.
-    F(i, p->rtabn) {
-        cell_ptr r = p->rtab[i];
-        if (r) {
-            cell_ptr next;
-            for(cell_ptr j = r->R; j != r; j = next) {
-                next = j->R;
-                free(j);
-            }
-            free(r);
-        }
-    }
-    // Columns may be covered, but they are always accessible from 'ctab'.
-    F(i, p->ctabn) free(p->ctab[i]);
+    // Every cell lives in the pool, so there is nothing to walk.
+    free(p->cell);
     free(p->rtab);
     free(p->ctab);
-    free(p->root);
+    free(p->S);
+    free(p->bound);
+    free(p->slack);
+    free(p->forced);
+    F(i, p->symn) free(p->sym[i]);
+    free(p->sym);
+    free(p->sym_ord);
+    free(p->ckpt);
+    free(p->replay);
+    free(p->undo);
+    free(p->mark);
+    stats_free(&p->stats);
     free(p);
 }
 
 int dlx_rows(dlx_t dlx) { return dlx->rtabn; }
+void dlx_set_stats(dlx_t dlx, int on) { dlx->stats_on = on; }
+
+void dlx_set_progress(dlx_t dlx, long long every, void (*cb)(double, long long)) {
+    dlx->progress_every = every;
+    dlx->progress = cb;
+}
+
+void dlx_set_checkpoint(dlx_t dlx, const char *path, long long every) {
+    free(dlx->ckpt);
+    dlx->ckpt = path && every > 0 ? strdup(path) : 0;
+    dlx->ckpt_every = every;
+}
+
+int dlx_get_stats(dlx_t p, struct dlx_stats_s *st) {
+    if (!p->stats_on) return -1;
+    *st = p->stats;
+    return 0;
+}
+
+static void json_counts(FILE *fp, const char *name, const long long *x, int n) {
+    fprintf(fp, ", \"%s\": [", name);
+    F(i, n) fprintf(fp, "%s%lld", i ? ", " : "", x[i]);
+    fputc(']', fp);
+}
+
+void dlx_print_stats(FILE *fp, const struct dlx_stats_s *st) {
+    fprintf(fp, "{\"nodes\": %lld, \"mems\": ", st->nodes);
+    if (st->mems < 0) fputs("null", fp); else fprintf(fp, "%lld", st->mems);
+    fprintf(fp, ", \"stuck\": %lld, \"solutions\": %lld, \"seconds\": %.6f",
+            st->stuck, st->solutions, st->seconds);
+    json_counts(fp, "nodes_at", st->nodes_at, st->depth);
+    json_counts(fp, "solutions_at", st->solutions_at, st->depth);
+    fputs(", \"seconds_at\": [", fp);
+    F(i, st->depth) fprintf(fp, "%s%.6f", i ? ", " : "", st->seconds_at[i]);
+    fputc(']', fp);
+    json_counts(fp, "branch", st->branch, DLX_STATS_BRANCH);
+    fputc('}', fp);
+}
+void dlx_set_strategy(dlx_t dlx, int strategy) { dlx->strategy = strategy; }
+void dlx_set_backend(dlx_t dlx, int backend) { dlx->backend = backend; }
+
+void dlx_set_row_order(dlx_t dlx, int order, uint64_t seed) {
+    dlx->row_order = order;
+    dlx->seed = seed;
+}
 int dlx_cols(dlx_t dlx) { return dlx->ctabn; }
 
-void dlx_add_col(dlx_t p) {
-    cell_ptr c = col_new();
-    LR_insert(c, p->root);
-    c->n = p->ctabn++;
-    if (p->ctabn == p->ctab_alloc) {
-        p->ctab = realloc(p->ctab, sizeof(cell_ptr) * (p->ctab_alloc *= 2));
+// Makes room for columns 0 to n, and one more, which add_col() relies on.
+static void col_room(dlx_t p, int n) {
+    if (n < p->ctab_alloc) return;
+    while (p->ctab_alloc <= n) p->ctab_alloc *= 2;
+    p->ctab = realloc(p->ctab, sizeof(link_t) * p->ctab_alloc);
+    p->S = realloc(p->S, sizeof(int) * p->ctab_alloc);
+    if (p->bound) {
+        p->bound = realloc(p->bound, sizeof(int) * p->ctab_alloc);
+        p->slack = realloc(p->slack, sizeof(int) * p->ctab_alloc);
     }
-    p->ctab[c->n] = c;
 }
 
-void dlx_add_row(dlx_t p) {
-    if (p->rtabn == p->rtab_alloc) {
-        p->rtab = realloc(p->rtab, sizeof(cell_ptr) * (p->rtab_alloc *= 2));
-    }
+// Makes room for n rows.
+static void row_room(dlx_t p, int n) {
+    if (n <= p->rtab_alloc) return;
+    while (p->rtab_alloc < n) p->rtab_alloc *= 2;
+    p->rtab = realloc(p->rtab, sizeof(link_t) * p->rtab_alloc);
+}
+
+static void add_col(dlx_t p) {
+    link_t c = col_new(p);
+    LR_insert(p->cell, c, root);
+    int n = p->cell[c].n = p->ctabn++;
+    col_room(p, p->ctabn);
+    p->ctab[n] = c;
+    p->S[n] = 0;
+    if (p->bound) p->bound[n] = 1, p->slack[n] = 0;
+}
+
+static void add_row(dlx_t p) {
+    row_room(p, p->rtabn + 1);
     p->rtab[p->rtabn++] = 0;
 }
 
-static void alloc_col(dlx_t p, int n) { while(p->ctabn <= n) dlx_add_col(p); }
-static void alloc_row(dlx_t p, int n) { while(p->rtabn <= n) dlx_add_row(p); }
+static void alloc_col(dlx_t p, int n) { while(p->ctabn <= n) add_col(p); }
+static void alloc_row(dlx_t p, int n) { while(p->rtabn <= n) add_row(p); }
+
+void dlx_reserve(dlx_t p, int rows, int cols, int nnz) {
+    row_room(p, rows);
+    col_room(p, cols);
+    // The root, a header per column, and a cell per 1.
+    link_t n = 1 + (link_t)cols + nnz;
+    if (n > p->cell_alloc) {
+        p->cell = realloc(p->cell, sizeof(*p->cell) * (p->cell_alloc = n));
+    }
+}
+
+// Permutes the pool so each column header is followed by the cells of its
+// column in top-to-bottom order, so walking a column reads adjacent memory.
+// Only indices move, so this is valid whatever dance has been done.
+static void layout(dlx_t p) {
+    if (!p->dirty) return;
+    cell_ptr a = p->cell;
+    link_t n = p->celln, *pos = malloc(sizeof(link_t) * n);
+    int *start = malloc(sizeof(int) * (p->ctabn + 1));
+    char *hdr = calloc(n, 1);
+    // Headers have no column of their own, so flag them.
+    F(j, p->ctabn) hdr[p->ctab[j]] = 1;
+    F(j, p->ctabn + 1) start[j] = 0;
+    for (link_t i = 1; i < n; i++) if (!hdr[i]) start[a[a[i].c].n + 1]++;
+    // Column j occupies a header then start[j + 1] cells.
+    start[0] = 1;
+    F(j, p->ctabn) start[j + 1] += start[j] + 1;
+    F(j, p->ctabn) pos[p->ctab[j]] = start[j]++;
+    // Cells were appended in the order dlx_set() saw them, which is their
+    // top-to-bottom order, so a stable pass keeps each column sorted.
+    for (link_t i = 1; i < n; i++) if (!hdr[i]) pos[i] = start[a[a[i].c].n]++;
+    pos[root] = root;
+    cell_ptr b = malloc(sizeof(*b) * p->cell_alloc);
+    F(i, n) {
+        cell_ptr x = b + pos[i];
+        *x = a[i];
+        x->U = pos[x->U], x->D = pos[x->D], x->L = pos[x->L], x->R = pos[x->R];
+    }
+    // Remap the column pointers of non-header cells.
+    F(j, p->ctabn) {
+        link_t c = pos[p->ctab[j]];
+        for (link_t i = c + 1; i < (link_t)(j + 1 < p->ctabn ?
+                pos[p->ctab[j + 1]] : n); i++) {
+            b[i].c = c;
+        }
+        p->ctab[j] = c;
+    }
+    F(i, p->rtabn) if (p->rtab[i]) p->rtab[i] = pos[p->rtab[i]];
+    F(i, p->undon) p->undo[i].x = pos[p->undo[i].x];
+    free(a);
+    free(hdr);
+    free(start);
+    free(pos);
+    p->cell = b;
+    p->dirty = 0;
+}
+
+static void *memdup(const void *x, size_t n) { return memcpy(malloc(n), x, n); }
+
+// Deep copies instance q into p.
+static void copy_into(dlx_t p, const struct dlx_s *q) {
+    *p = *q;
+    p->ctab = memdup(q->ctab, sizeof(link_t) * q->ctab_alloc);
+    p->S = memdup(q->S, sizeof(int) * q->ctab_alloc);
+    p->rtab = memdup(q->rtab, sizeof(link_t) * q->rtab_alloc);
+    p->cell = memdup(q->cell, sizeof(*q->cell) * q->cell_alloc);
+    if (q->bound) {
+        p->bound = memdup(q->bound, sizeof(int) * q->ctab_alloc);
+        p->slack = memdup(q->slack, sizeof(int) * q->ctab_alloc);
+    }
+    if (q->forced) p->forced = memdup(q->forced, sizeof(int) * q->forcedn);
+    if (q->sym) {
+        p->sym = memdup(q->sym, sizeof(int *) * q->symn);
+        F(i, q->symn) p->sym[i] = memdup(q->sym[i], sizeof(int) * (q->sym[i][0] + 1));
+    }
+    if (q->sym_ord) p->sym_ord = memdup(q->sym_ord, sizeof(int) * q->sym_ordn);
+    if (q->ckpt) p->ckpt = strdup(q->ckpt);
+    if (q->replay) p->replay = memdup(q->replay, sizeof(int) * (q->replayn + 1));
+    if (q->undo) p->undo = memdup(q->undo, sizeof(*q->undo) * q->undo_alloc);
+    if (q->mark) p->mark = memdup(q->mark, sizeof(int) * q->markn);
+    // Statistics are per instance.
+    p->stats = (struct dlx_stats_s) { 0 };
+}
+
+// A laid-out instance that is never danced on, only copied.
+struct dlx_compiled_s {
+    dlx_t m;
+};
+
+dlx_compiled_t dlx_compile(dlx_t p) {
+    layout(p);
+    dlx_compiled_t c = malloc(sizeof(*c));
+    // Trim the pool, as every state gets a copy.
+    link_t alloc = p->cell_alloc;
+    p->cell_alloc = p->celln;
+    copy_into(c->m = malloc(sizeof(*c->m)), p);
+    p->cell_alloc = alloc;
+    return c;
+}
+
+dlx_t dlx_state_new(dlx_compiled_t c) {
+    dlx_t p = malloc(sizeof(*p));
+    copy_into(p, c->m);
+    return p;
+}
+
+void dlx_compiled_free(dlx_compiled_t c) {
+    dlx_clear(c->m);
+    free(c);
+}
 
 void dlx_mark_optional(dlx_t p, int col) {
     alloc_col(p, col);
-    cell_ptr c = p->ctab[col];
+    cell_ptr a = p->cell;
+    link_t c = p->ctab[col];
+    if (a[c].L == c) return;  // Already optional.
     // Prevent undeletion by self-linking.
-    LR_self(LR_delete(c));
+    LR_self(a, LR_delete(a, c));
+    p->S[col] += INACTIVE;
+}
+
+// Appends a cell for the given row to the bottom of column c.
+static link_t new1(dlx_t p, int row, link_t c) {
+    link_t n = cell_new(p);
+    cell_ptr a = p->cell;
+    a[n].n = row;
+    a[n].c = c;
+    a[n].color = 0;
+    p->S[a[c].n]++;
+    return UD_insert(a, n, c);
 }
 
-void dlx_set(dlx_t p, int row, int col) {
+// Returns the cell for the given row and column, adding it if need be.
+static link_t set1(dlx_t p, int row, int col) {
     // We don't bother sorting. DLX works fine with jumbled rows and columns.
     // We just have to watch out for duplicates. (Actually, I think the DLX code
     // works even with duplicates, though it would be inefficient.)
@@ -128,92 +458,2773 @@ void dlx_set(dlx_t p, int row, int col) {
     // is called, not by row number. Similarly for a given row and its LR list.
     alloc_row(p, row);
     alloc_col(p, col);
-    cell_ptr c = p->ctab[col];
-    cell_ptr new1() {
-        cell_ptr n = malloc(sizeof(*n));
-        n->n = row;
-        n->c = c;
-        c->s++;
-        UD_insert(n, c);
-        return n;
-    }
-    cell_ptr *rp = p->rtab + row;
+    link_t c = p->ctab[col];
+    link_t *rp = p->rtab + row;
     if (!*rp) {
-        *rp = LR_self(new1());
-        return;
+        link_t n = new1(p, row, c);
+        return *rp = LR_self(p->cell, n);
     }
+    cell_ptr a = p->cell;
     // Ignore duplicates.
-    if ((*rp)->c->n == col) return;
-    C(r, *rp, R) if (r->c->n == col) return;
+    if (a[*rp].c == c) return *rp;
+    C(r, *rp, R) if (a[r].c == c) return r;
     // Otherwise insert at end of LR list.
-    LR_insert(new1(), *rp);
+    link_t n = new1(p, row, c);
+    return LR_insert(p->cell, n, *rp);
+}
+
+void dlx_set(dlx_t p, int row, int col) { set1(p, row, col); }
+
+// Adds a row with the given columns, each with the given color unless
+// 'color' is NULL or the color is 0.
+static int add_cells(dlx_t p, const int *cols, const int *color, int n) {
+    int row = p->rtabn;
+    add_row(p);
+    link_t first = 0;
+    F(i, n) {
+        alloc_col(p, cols[i]);
+        link_t c = p->ctab[cols[i]];
+        // The row is new, so any cell it already has in this column was the
+        // last one added there.
+        if (p->cell[c].U != c && p->cell[p->cell[c].U].n == row) continue;
+        link_t x = new1(p, row, c);
+        if (!first) first = LR_self(p->cell, x); else LR_insert(p->cell, x, first);
+        if (color && color[i]) {
+            p->cell[x].color = color[i];
+            p->colors = 1;
+            dlx_mark_optional(p, cols[i]);
+        }
+    }
+    p->rtab[row] = first;
+    return row;
+}
+
+int dlx_add_row(dlx_t p, const int *cols, int n) { return add_cells(p, cols, 0, n); }
+
+// Undoes dlx_mark_optional(), linking the column back among the others in
+// column order.
+static void mark_primary(dlx_t p, int col) {
+    cell_ptr a = p->cell;
+    link_t c = p->ctab[col], k = root;
+    if (a[c].L != c) return;  // Already primary.
+    for (int j = col + 1; j < p->ctabn && k == root; j++) {
+        if (a[p->ctab[j]].L != p->ctab[j]) k = p->ctab[j];
+    }
+    LR_insert(a, c, k);
+    p->S[col] -= INACTIVE;
+}
+
+void dlx_set_bounds(dlx_t p, int col, int lo, int hi) {
+    alloc_col(p, col);
+    if (!lo && hi == 1) {
+        dlx_mark_optional(p, col);
+        lo = 1;  // Being optional says it all.
+    } else {
+        // Algorithm M takes any optional column to be covered at most once.
+        mark_primary(p, col);
+    }
+    if (lo == 1 && hi == 1) {
+        if (!p->bound) return;
+        p->bound[col] = 1, p->slack[col] = 0;
+        // Once no column has other bounds, the usual search will do.
+        F(i, p->ctabn) if (p->bound[i] != 1 || p->slack[i]) return;
+        free(p->bound);
+        free(p->slack);
+        p->bound = p->slack = 0;
+        return;
+    }
+    if (!p->bound) {
+        p->bound = malloc(sizeof(int) * p->ctab_alloc);
+        p->slack = malloc(sizeof(int) * p->ctab_alloc);
+        F(i, p->ctabn) p->bound[i] = 1, p->slack[i] = 0;
+    }
+    p->bound[col] = hi;
+    p->slack[col] = hi - lo;
+}
+
+void dlx_set_color(dlx_t p, int row, int col, int color) {
+    link_t n = set1(p, row, col);
+    p->cell[n].color = color;
+    p->colors = 1;
+    dlx_mark_optional(p, col);
+}
+
+// The file written by dlx_save(), in native byte order, so only a machine
+// with the same byte order reads it back, every part padded to a multiple of
+// 4 bytes:
+//
+//   struct dlx_file_s          header
+//   uint32_t off[rows + 1]     row i has the 1s off[i] to off[i + 1] - 1
+//   int32_t col[nnz]           their columns
+//   int32_t color[nnz]         their colors, 0 for none, if DLX_FILE_COLORS
+//   uint8_t optional[cols]     1 for an optional column
+//   int32_t lo[cols], hi[cols] column bounds, if DLX_FILE_BOUNDS
+//   uint32_t loff[rows + 1]    row i's label starts at byte loff[i] of
+//   char label[]               these NUL-terminated strings, if DLX_FILE_LABELS
+enum { DLX_FILE_COLORS = 1, DLX_FILE_BOUNDS = 2, DLX_FILE_LABELS = 4 };
+static const char dlx_magic[8] = "DLXMAT1";
+struct dlx_file_s {
+    char magic[8];
+    uint32_t one;  // Reads as 1 in the byte order the file was written in.
+    uint32_t rows, cols, nnz, flags, label_bytes;
+};
+
+static size_t pad4(size_t n) { return (n + 3) & ~(size_t)3; }
+
+// Writes n bytes then pads to a multiple of 4, counting them in *at.
+static int file_put(FILE *fp, size_t *at, const void *x, size_t n) {
+    static const char zero[4];
+    size_t pad = pad4(*at + n) - *at - n;
+    *at += n + pad;
+    return fwrite(x, 1, n, fp) == n && fwrite(zero, 1, pad, fp) == pad;
+}
+
+int dlx_save(dlx_t p, const char *path, const char *const labels[]) {
+    layout(p);
+    cell_ptr a = p->cell;
+    struct dlx_file_s h = {
+        .one = 1, .rows = p->rtabn, .cols = p->ctabn,
+        .flags = (p->colors ? DLX_FILE_COLORS : 0) | (p->bound ? DLX_FILE_BOUNDS : 0) |
+                 (labels ? DLX_FILE_LABELS : 0),
+    };
+    memcpy(h.magic, dlx_magic, 8);
+    uint32_t *off = malloc(sizeof(uint32_t) * (p->rtabn + 1)), *loff = 0;
+    off[0] = 0;
+    F(i, p->rtabn) {
+        link_t r = p->rtab[i];
+        int n = 0;
+        if (r) { n++; C(j, r, R) n++; }
+        off[i + 1] = off[i] + n;
+    }
+    h.nnz = off[p->rtabn];
+    int32_t *col = malloc(sizeof(int32_t) * (h.nnz + 1)), *color = malloc(sizeof(int32_t) * (h.nnz + 1));
+    F(i, p->rtabn) if (p->rtab[i]) {
+        link_t x = p->rtab[i];
+        int k = off[i];
+        do {
+            col[k] = a[a[x].c].n;
+            // A purified cell keeps its color in the header.
+            color[k++] = a[x].color < 0 ? a[a[x].c].color : a[x].color;
+        } while ((x = a[x].R) != p->rtab[i]);
+    }
+    if (labels) {
+        loff = malloc(sizeof(uint32_t) * (p->rtabn + 1));
+        loff[0] = 0;
+        F(i, p->rtabn) loff[i + 1] = loff[i] + strlen(labels[i] ? labels[i] : "") + 1;
+        h.label_bytes = loff[p->rtabn];
+    }
+    FILE *fp = fopen(path, "wb");
+    int res = -1;
+    if (fp) {
+        size_t at = 0;
+        uint8_t *opt = malloc(p->ctabn + 1);
+        int32_t *lo = malloc(sizeof(int32_t) * (2 * p->ctabn + 1)), *hi = lo + p->ctabn;
+        F(j, p->ctabn) {
+            link_t c = p->ctab[j];
+            opt[j] = a[c].L == c;
+            if (p->bound) hi[j] = p->bound[j], lo[j] = p->bound[j] - p->slack[j];
+        }
+        int ok = file_put(fp, &at, &h, sizeof(h)) &&
+                file_put(fp, &at, off, sizeof(uint32_t) * (h.rows + 1)) &&
+                file_put(fp, &at, col, sizeof(int32_t) * h.nnz) &&
+                (!p->colors || file_put(fp, &at, color, sizeof(int32_t) * h.nnz)) &&
+                file_put(fp, &at, opt, h.cols) &&
+                (!p->bound || file_put(fp, &at, lo, sizeof(int32_t) * 2 * h.cols));
+        if (ok && labels) {
+            ok = file_put(fp, &at, loff, sizeof(uint32_t) * (h.rows + 1));
+            F(i, p->rtabn) {
+                const char *l = labels[i] ? labels[i] : "";
+                if (ok) ok = fwrite(l, 1, strlen(l) + 1, fp) == strlen(l) + 1;
+            }
+        }
+        if (!fclose(fp) && ok) res = 0;
+        free(opt);
+        free(lo);
+    }
+    free(off);
+    free(loff);
+    free(col);
+    free(color);
+    return res;
+}
+
+dlx_t dlx_load(const char *path, char ***labels) {
+    if (labels) *labels = 0;
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return 0;
+    struct stat st;
+    size_t size = fstat(fd, &st) ? 0 : st.st_size;
+    const char *m = size >= sizeof(struct dlx_file_s) ?
+            mmap(0, size, PROT_READ, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+    close(fd);
+    if (m == MAP_FAILED) return 0;
+    struct dlx_file_s h;
+    memcpy(&h, m, sizeof(h));
+    // Offsets of the parts, checked against the size before anything is read.
+    size_t at = pad4(sizeof(h)), o_off = at, o_col, o_color, o_opt, o_bound, o_loff, o_label;
+    at += pad4(sizeof(uint32_t) * ((size_t)h.rows + 1));
+    o_col = at, at += pad4(sizeof(int32_t) * (size_t)h.nnz);
+    o_color = at;
+    if (h.flags & DLX_FILE_COLORS) at += pad4(sizeof(int32_t) * (size_t)h.nnz);
+    o_opt = at, at += pad4(h.cols);
+    o_bound = at;
+    if (h.flags & DLX_FILE_BOUNDS) at += pad4(sizeof(int32_t) * 2 * (size_t)h.cols);
+    o_loff = at;
+    if (h.flags & DLX_FILE_LABELS) at += pad4(sizeof(uint32_t) * ((size_t)h.rows + 1));
+    o_label = at;
+    if (h.flags & DLX_FILE_LABELS) at += h.label_bytes;
+    const uint32_t *off = (const uint32_t *)(m + o_off);
+    int bad = memcmp(h.magic, dlx_magic, 8) || h.one != 1 || at > size ||
+            h.rows >= INT_MAX / 8 || h.cols >= INT_MAX / 8 || h.nnz >= INT_MAX / 8 ||
+            off[0] || off[h.rows] != h.nnz;
+    if (!bad) F(i, (int)h.rows) if (off[i] > off[i + 1]) bad = 1;
+    const int32_t *col = (const int32_t *)(m + o_col);
+    if (!bad) F(k, (int)h.nnz) if (col[k] < 0 || (uint32_t)col[k] >= h.cols) bad = 1;
+    const int32_t *lo = (const int32_t *)(m + o_bound), *hi = lo + h.cols;
+    if (!bad && h.flags & DLX_FILE_BOUNDS) F(j, (int)h.cols) if (lo[j] < 0 || hi[j] < lo[j] || hi[j] < 1) bad = 1;
+    if (bad) {
+        munmap((void *)m, size);
+        return 0;
+    }
+    dlx_t p = dlx_new();
+    dlx_reserve(p, h.rows, h.cols, h.nnz);
+    if (h.cols) alloc_col(p, h.cols - 1);
+    const uint8_t *opt = (const uint8_t *)(m + o_opt);
+    F(j, (int)h.cols) if (opt[j]) dlx_mark_optional(p, j);
+    const int32_t *color = h.flags & DLX_FILE_COLORS ? (const int32_t *)(m + o_color) : 0;
+    F(i, (int)h.rows) add_cells(p, col + off[i], color ? color + off[i] : 0, off[i + 1] - off[i]);
+    if (h.flags & DLX_FILE_BOUNDS) {
+        F(j, (int)h.cols) if (lo[j] != 1 || hi[j] != 1) dlx_set_bounds(p, j, lo[j], hi[j]);
+    }
+    if (labels && h.flags & DLX_FILE_LABELS) {
+        // The pointers, then the strings they point to, in one block.
+        const uint32_t *loff = (const uint32_t *)(m + o_loff);
+        char **l = malloc(sizeof(char *) * h.rows + h.label_bytes + 1);
+        char *text = (char *)(l + h.rows);
+        memcpy(text, m + o_label, h.label_bytes);
+        text[h.label_bytes] = 0;
+        F(i, (int)h.rows) l[i] = text + (loff[i] < h.label_bytes ? loff[i] : h.label_bytes);
+        *labels = l;
+    }
+    munmap((void *)m, size);
+    return p;
+}
+
+// Sizes live in a dense array S rather than in the headers, so the column to
+// branch on can be found by a straight scan that the compiler vectorizes
+// instead of a walk along the header list. Covered and optional columns are
+// biased by INACTIVE so the scan never picks them.
+static void hide_row(cell_ptr a, int *S, link_t r) {
+    C(j, r, R) S[a[a[UD_delete(a, j)].c].n]--;
+}
+
+static void unhide_row(cell_ptr a, int *S, link_t r) {
+    C(j, r, L) S[a[a[UD_restore(a, j)].c].n]++;
+}
+
+static void cover_col(cell_ptr a, int *S, link_t c) {
+    S[a[c].n] += INACTIVE;
+    LR_delete(a, c);
+    C(i, c, D) hide_row(a, S, i);
+}
+
+static void uncover_col(cell_ptr a, int *S, link_t c) {
+    C(i, c, U) unhide_row(a, S, i);
+    LR_restore(a, c);
+    S[a[c].n] -= INACTIVE;
+}
+
+// Knuth's purify: once a row gives the column of cell x a color, hide the
+// rows that give it any other color, and mark those that agree. Knuth also
+// leaves marked cells linked when their rows are hidden later, which saves a
+// little work but costs a test in the innermost loop; unlinking them is just
+// as correct, since everything is undone in reverse order.
+static void purify(cell_ptr a, int *S, link_t x) {
+    link_t c = a[x].c;
+    int color = a[c].color = a[x].color;
+    C(i, c, D) if (a[i].color == color) a[i].color = -1; else hide_row(a, S, i);
+}
+
+static void unpurify(cell_ptr a, int *S, link_t x) {
+    link_t c = a[x].c;
+    int color = a[c].color;
+    C(i, c, U) if (a[i].color < 0) a[i].color = color; else unhide_row(a, S, i);
+}
+
+// Deals with the column of cell j, in a row that has been chosen.
+static void commit(cell_ptr a, int *S, link_t j) {
+    if (!a[j].color) cover_col(a, S, a[j].c);
+    else if (a[j].color > 0) purify(a, S, j);
 }
 
-static void cover_col(cell_ptr c) {
-    LR_delete(c);
-    C(i, c, D) C(j, i, R) UD_delete(j)->c->s--;
+static void uncommit(cell_ptr a, int *S, link_t j) {
+    if (!a[j].color) uncover_col(a, S, a[j].c);
+    else if (a[j].color > 0) unpurify(a, S, j);
 }
 
-static void uncover_col(cell_ptr c) {
-    C(i, c, U) C(j, i, L) UD_restore(j)->c->s++;
-    LR_restore(c);
+// Returns the first column of least size, or n if every column is inactive.
+// Both passes are simple enough to vectorize, and the second stops at the
+// same column a walk along the header list would.
+static int min_col(const int *S, int n) {
+    int size = INACTIVE;
+    F(i, n) size = S[i] < size ? S[i] : size;
+    if (size == INACTIVE) return n;
+    int i = 0;
+    while (S[i] != size) i++;
+    return i;
+}
+
+// Like min_col(), but returns one of the columns of least size at random.
+static int rand_min_col(const int *S, int n, uint64_t *rng) {
+    int size = INACTIVE, k = 0;
+    F(i, n) size = S[i] < size ? S[i] : size;
+    if (size == INACTIVE) return n;
+    F(i, n) k += S[i] == size;
+    k = rng_next(rng) % k;
+    int i = 0;
+    while (S[i] != size || k--) i++;
+    return i;
+}
+
+// Like min_col(), but weighs each column's size against how often it has been
+// stuck, preferring the first column of least S[i] / W[i]. This is the
+// dom/wdeg rule of constraint solvers: columns that keep causing dead ends
+// are tried early, when a dead end is cheap.
+static int wdeg_col(const int *S, const int *W, int n) {
+    int best = n;
+    F(i, n) {
+        if (S[i] >= INACTIVE) continue;
+        if (!S[i]) return i;
+        if (best == n || (long long)S[i] * W[best] < (long long)S[best] * W[i]) {
+            best = i;
+        }
+    }
+    return best;
+}
+
+// Covers every column of row r, starting with its first.
+static void pick(cell_ptr a, int *S, link_t r) {
+    commit(a, S, r);
+    C(j, r, R) commit(a, S, j);
+}
+
+// Undoes pick(a, S, r).
+static void unpick(cell_ptr a, int *S, link_t r) {
+    C(j, r, L) uncommit(a, S, j);
+    uncommit(a, S, r);
+}
+
+// Like pick(), for a row chosen outside the search. The row leaves its
+// columns first, as the search's rows have, lest purifying a column mark the
+// row's own cell, after which uncommit() would not know to unpurify it.
+static void select_row(cell_ptr a, int *S, link_t r) {
+    hide_row(a, S, r);
+    S[a[a[UD_delete(a, r)].c].n]--;
+    pick(a, S, r);
+}
+
+static void unselect_row(cell_ptr a, int *S, link_t r) {
+    unpick(a, S, r);
+    S[a[a[UD_restore(a, r)].c].n]++;
+    unhide_row(a, S, r);
+}
+
+// Commits the cells of row r after the first, for a search with bounds: a
+// primary column is covered once it may take no more rows.
+static void mcommit_row(cell_ptr a, int *S, int *B, link_t r) {
+    C(j, r, R) {
+        link_t c = a[j].c;
+        if (a[c].L == c) commit(a, S, j);  // Optional.
+        else if (!--B[a[c].n]) cover_col(a, S, c);
+    }
+}
+
+static void muncommit_row(cell_ptr a, int *S, int *B, link_t r) {
+    C(j, r, L) {
+        link_t c = a[j].c;
+        if (a[c].L == c) uncommit(a, S, j);
+        else if (!B[a[c].n]++) uncover_col(a, S, c);
+    }
+}
+
+// Like pick(), for an instance with bounds. The row itself leaves every
+// column, as a column may still have room for others.
+static void mpick(cell_ptr a, int *S, int *B, link_t r) {
+    link_t c = a[r].c;
+    hide_row(a, S, r);
+    S[a[a[UD_delete(a, r)].c].n]--;
+    if (a[c].L == c) commit(a, S, r);
+    else if (!--B[a[c].n]) cover_col(a, S, c);
+    mcommit_row(a, S, B, r);
+}
+
+static void munpick(cell_ptr a, int *S, int *B, link_t r) {
+    link_t c = a[r].c;
+    muncommit_row(a, S, B, r);
+    if (a[c].L == c) uncommit(a, S, r);
+    else if (!B[a[c].n]++) uncover_col(a, S, c);
+    S[a[a[UD_restore(a, r)].c].n]++;
+    unhide_row(a, S, r);
+}
+
+// Logs a change if a dlx_push() mark is outstanding.
+static void undo_log(dlx_t p, int op, int row, link_t x) {
+    if (!p->markn) return;
+    if (p->undon == p->undo_alloc) {
+        p->undo = realloc(p->undo, sizeof(*p->undo) * (p->undo_alloc = 2 * p->undo_alloc + 16));
+    }
+    p->undo[p->undon++] = (struct undo_s) { op, row, x };
+}
+
+// Returns whether cell y of a row is still in play: its column is neither
+// covered nor purified against it, and it has not been hidden.
+static int cell_live(cell_ptr a, const int *S, link_t y) {
+    link_t c = a[y].c;
+    int size = S[a[c].n];
+    if (size >= INACTIVE && (a[c].L != c || size >= 2 * INACTIVE)) return 0;
+    return a[a[y].U].D == y;
+}
+
+// Returns whether every cell of row r is in play.
+static int row_live(dlx_t p, link_t r) {
+    cell_ptr a = p->cell;
+    int live = cell_live(a, p->S, r);
+    C(k, r, R) live &= cell_live(a, p->S, k);
+    return live;
 }
 
 int dlx_pick_row(dlx_t p, int i) {
     if (i < 0 || i >= p->rtabn) return -1;
-    cell_ptr r = p->rtab[i];
+    layout(p);
+    link_t r = p->rtab[i];
     if (!r) return 0;  // Empty row.
-    cover_col(r->c);
-    C(j, r, R) cover_col(j->c);
+    // A row that clashes with one already picked would tear the links.
+    if (!row_live(p, r)) return -1;
+    if (p->bound) mpick(p->cell, p->S, p->bound, r); else select_row(p->cell, p->S, r);
+    undo_log(p, UNDO_PICK, i, r);
     return 0;
 }
 
 int dlx_remove_row(dlx_t p, int i) {
     if (i < 0 || i >= p->rtabn) return -1;
-    cell_ptr r = p->rtab[i];
+    layout(p);
+    cell_ptr a = p->cell;
+    link_t r = p->rtab[i];
     if (!r) return 0;  // Empty row.
-    UD_delete(r)->c->s--;
+    // A row picked, or hidden by a pick, is no longer in its columns.
+    if (!row_live(p, r)) return -1;
+    p->S[a[a[UD_delete(a, r)].c].n]--;
     C(j, r, R){
-        UD_delete(j)->c->s--;
+        p->S[a[a[UD_delete(a, j)].c].n]--;
     }
     p->rtab[i] = 0;
+    undo_log(p, UNDO_REMOVE, i, r);
     return 0;
 }
 
-void dlx_solve(dlx_t p,
-                              void (*try_cb)(int, int, int),
-                              void (*undo_cb)(void),
-                              void (*found_cb)(),
-                              void (*stuck_cb)()) {
-    void recurse() {
-        cell_ptr c = p->root->R;
-        if (c == p->root) {
-            if (found_cb) found_cb();
-            return;
-        }
-        int s = INT_MAX;  // S-heuristic: choose first most-constrained column.
-        C(i, p->root, R) if (i->s < s) s = (c = i)->s;
-        if (!s) {
-            if (stuck_cb) stuck_cb(c->n);
-            return;
-        }
-        cover_col(c);
-        C(r, c, D) {
-            if (try_cb) try_cb(c->n, s, r->n);
-            C(j, r, R) cover_col(j->c);
-            recurse();
-            if (undo_cb) undo_cb();
-            C(j, r, L) uncover_col(j->c);
-        }
-        uncover_col(c);
-    }
-    recurse();
+int dlx_add_symmetry(dlx_t p, const int perm[]) {
+    int n = p->rtabn, *inv = malloc(sizeof(int) * (n + 1));
+    F(i, n) inv[i + 1] = -1;
+    F(i, n) {
+        if (perm[i] < 0 || perm[i] >= n || inv[perm[i] + 1] >= 0) {
+            free(inv);
+            return -1;
+        }
+        inv[perm[i] + 1] = i;
+    }
+    inv[0] = n;
+    p->sym = realloc(p->sym, sizeof(int *) * (p->symn + 1));
+    p->sym[p->symn++] = inv;
+    return 0;
 }
 
-void dlx_forall_cover(dlx_t p, void (*cb)(int[], int)) {
-    int sol[p->rtabn], soln = 0;
-    void cover(int c, int s, int r) { sol[soln++] = r; }
-    void uncover() { soln--; }
-    void found() { cb(sol, soln); }
-    dlx_solve(p, cover, uncover, found, NULL);
+// Returns the cell of row r in column c, or 0.
+static link_t row_find(cell_ptr a, link_t r, link_t c) {
+    if (a[r].c == c) return r;
+    C(k, r, R) if (a[k].c == c) return k;
+    return 0;
+}
+
+// Takes column j out of the rows of its cells for good, once it is covered
+// exactly when another column is.
+static void drop_col(dlx_t p, link_t j) {
+    cell_ptr a = p->cell;
+    C(y, j, D) {
+        link_t *rp = p->rtab + a[y].n;
+        if (*rp == y) undo_log(p, UNDO_HEAD, a[y].n, y), *rp = a[y].R;
+        LR_delete(a, y);
+    }
+    // Covered, as far as cell_live() can tell.
+    if (a[j].L != j) LR_delete(a, j);
+    p->S[a[j].n] += INACTIVE;
+    undo_log(p, UNDO_DROP, -1, j);
+}
+
+static void undrop_col(dlx_t p, link_t j) {
+    cell_ptr a = p->cell;
+    p->S[a[j].n] -= INACTIVE;
+    if (a[j].L != j) LR_restore(a, j);
+    C(y, j, U) LR_restore(a, y);
+}
+
+int dlx_reduce(dlx_t p, struct dlx_reduce_s *stats) {
+    struct dlx_reduce_s dummy;
+    if (!stats) stats = &dummy;
+    *stats = (struct dlx_reduce_s) { 0 };
+    if (p->bound) return 0;
+    layout(p);
+    cell_ptr a = p->cell;
+    int *S = p->S, stamp = 0, res = 0;
+    // Scratch for the clash rule: per column, a count of the rows that
+    // clash with the row at hand, valid if cstamp matches; per row, whether
+    // it has been counted.
+    int *cnt = malloc(sizeof(int) * p->ctabn), *cstamp = calloc(p->ctabn, sizeof(int));
+    int *rstamp = calloc(p->rtabn, sizeof(int)), *touched = malloc(sizeof(int) * p->ctabn);
+    for (int changed = 1; changed && !res;) {
+        changed = 0;
+        // A column with no rows has no cover; one with a single row forces it.
+        C(c, root, R) {
+            if (!S[a[c].n]) {
+                res = -1;
+                break;
+            }
+            if (S[a[c].n] == 1) {
+                link_t r = p->rtab[a[a[c].D].n];
+                p->forced = realloc(p->forced, sizeof(int) * (p->forcedn + 1));
+                p->forced[p->forcedn++] = a[r].n;
+                select_row(a, S, r);
+                undo_log(p, UNDO_FORCE, a[r].n, r);
+                stats->forced++;
+                changed = 1;
+                break;
+            }
+        }
+        if (res || changed) continue;
+        // If every row of column i has column j, then whichever covers i
+        // covers j, so the other rows of j can go, and so can j.
+        C(i, root, R) {
+            link_t y0 = a[i].D;
+            C(x, y0, R) {
+                link_t j = a[x].c;
+                int sub = 1;
+                C(y, j, D) if (a[y].color) sub = 0;
+                C(y, i, D) if (y != y0 && sub && !row_find(a, y, j)) sub = 0;
+                if (!sub) continue;
+                C(y, j, D) if (!row_find(a, y, i)) {
+                    dlx_remove_row(p, a[y].n);
+                    stats->removed++;
+                }
+                drop_col(p, j);
+                stats->merged++;
+                changed = 1;
+                break;
+            }
+            if (changed) break;
+        }
+        if (changed) continue;
+        // A row that clashes with every row of some column has no place in a
+        // solution, and neither has one without a primary column.
+        F(row, p->rtabn) {
+            link_t r = p->rtab[row];
+            if (!r || !row_live(p, r)) continue;
+            stamp++;
+            int n = 0, primary = 0;
+            link_t x = r;
+            do {
+                link_t c = a[x].c;
+                primary |= a[c].L != c;
+                C(y, c, D) {
+                    if (y == x || a[y].n == row) continue;
+                    if (a[x].color && a[x].color == a[y].color) continue;
+                    if (rstamp[a[y].n] == stamp) continue;
+                    rstamp[a[y].n] = stamp;
+                    link_t z = y;
+                    do {
+                        int k = a[a[z].c].n;
+                        if (cstamp[k] != stamp) cstamp[k] = stamp, cnt[k] = 0, touched[n++] = k;
+                        cnt[k]++;
+                    } while ((z = a[z].R) != y);
+                }
+            } while ((x = a[x].R) != r);
+            int dead = !primary;
+            F(t, n) {
+                int k = touched[t];
+                if (cnt[k] == S[k] && S[k] < INACTIVE && !row_find(a, r, p->ctab[k])) dead = 1;
+            }
+            if (dead) {
+                dlx_remove_row(p, row);
+                stats->removed++;
+                changed = 1;
+            }
+        }
+    }
+    free(cnt);
+    free(cstamp);
+    free(rstamp);
+    free(touched);
+    return res;
+}
+
+void dlx_push(dlx_t p) {
+    layout(p);
+    p->mark = realloc(p->mark, sizeof(int) * (p->markn + 1));
+    p->mark[p->markn++] = p->undon;
+}
+
+int dlx_pop(dlx_t p) {
+    if (!p->markn) return -1;
+    cell_ptr a = p->cell;
+    // Undo in reverse order, so each change sees the links it made.
+    for (int t = p->mark[--p->markn]; p->undon > t;) {
+        struct undo_s *u = p->undo + --p->undon;
+        switch (u->op) {
+        case UNDO_FORCE:
+            p->forcedn--;
+            // Fall through.
+        case UNDO_PICK:
+            if (p->bound) munpick(a, p->S, p->bound, u->x); else unselect_row(a, p->S, u->x);
+            break;
+        case UNDO_REMOVE:
+            C(j, u->x, L) p->S[a[a[UD_restore(a, j)].c].n]++;
+            p->S[a[a[UD_restore(a, u->x)].c].n]++;
+            p->rtab[u->row] = u->x;
+            break;
+        case UNDO_DROP:
+            undrop_col(p, u->x);
+            break;
+        case UNDO_HEAD:
+            p->rtab[u->row] = u->x;
+            break;
+        case UNDO_SYM:
+            free(p->sym_ord);
+            p->sym_ord = 0;
+            p->sym_ordn = 0;
+            p->sym_col = -1;
+            break;
+        }
+    }
+    return 0;
+}
+
+// Dancing cells, Knuth's sparse-set alternative to dancing links. Each item
+// (column) keeps the nodes of its options (rows) in a slice of one array,
+// live ones first, so taking an option out of an item swaps it with the last
+// live node, and putting it back just grows the slice again. Undoing is thus
+// a matter of restoring lengths: the first time an item shrinks after a
+// checkpoint, its length goes on a trail. The cells are built from the links
+// when a search starts, so rows picked or removed stay that way.
+struct dc_node {
+    int item, loc;  // Item, and position in its slice.
+};
+
+struct dc_trail {
+    int m, S;  // Restores S[m], or if m is negative, uncolors item ~m.
+};
+
+// Added to the length of an item covered by a chosen option.
+enum { DONE = 1 << 30 };
+
+struct cells_s {
+    int n;        // Items, one per column.
+    // Lengths, biased by INACTIVE like the links' sizes, and DONE once
+    // covered.
+    int *S;
+    int *beg;     // Start of each item's slice of 'set'.
+    int *set;     // Nodes, grouped by item.
+    int *color;   // Color an item has been purified to, or 0.
+    struct dc_node *node;  // Grouped by option.
+    int *ncolor, *opt;     // Color and option number of each node.
+    int *ostart;  // First node of each option, and one past the last.
+    int *orow;    // Row number of each option.
+    struct dc_trail *trail;
+    int trailn, trail_alloc;
+    // An item's length is on the trail since the last checkpoint if its stamp
+    // is the current epoch.
+    int *stamp, epoch;
+};
+
+static struct cells_s *dc_new(dlx_t p) {
+    cell_ptr a = p->cell;
+    struct cells_s *d = malloc(sizeof(*d));
+    int n = d->n = p->ctabn, *node = malloc(sizeof(int) * p->celln);
+    int opts = 0, nodes = 0;
+    F(i, p->celln) node[i] = -1;
+    // Number the nodes of rows still in play, row by row.
+    F(pass, 2) {
+        opts = nodes = 0;
+        F(i, p->rtabn) {
+            link_t r = p->rtab[i], j = r;
+            if (!r || !row_live(p, r)) continue;
+            if (pass) d->orow[opts] = i, d->ostart[opts] = nodes;
+            do {
+                if (pass) {
+                    link_t c = a[j].c;
+                    node[j] = nodes;
+                    d->node[nodes].item = a[c].n;
+                    d->ncolor[nodes] = a[j].color < 0 ? a[c].color : a[j].color;
+                    d->opt[nodes] = opts;
+                }
+                nodes++;
+            } while ((j = a[j].R) != r);
+            opts++;
+        }
+        if (pass) break;
+        d->node = malloc(sizeof(*d->node) * nodes);
+        d->ncolor = malloc(sizeof(int) * nodes);
+        d->opt = malloc(sizeof(int) * nodes);
+        d->set = malloc(sizeof(int) * nodes);
+        d->ostart = malloc(sizeof(int) * (opts + 1));
+        d->orow = malloc(sizeof(int) * (opts + 1));
+    }
+    d->ostart[opts] = nodes;
+    d->S = malloc(sizeof(int) * n);
+    d->beg = malloc(sizeof(int) * n);
+    d->color = malloc(sizeof(int) * n);
+    d->stamp = malloc(sizeof(int) * n);
+    d->epoch = 0;
+    d->trail_alloc = 64;
+    d->trail = malloc(sizeof(*d->trail) * d->trail_alloc);
+    d->trailn = 0;
+    // Lay out the slices in column order, keeping each column's row order.
+    int k = 0;
+    F(i, n) {
+        link_t c = p->ctab[i];
+        d->beg[i] = k;
+        d->color[i] = 0;
+        d->stamp[i] = -1;
+        C(y, c, D) if (node[y] >= 0) {
+            if (a[y].color < 0) d->color[i] = a[c].color;
+            d->node[node[y]].loc = k;
+            d->set[k++] = node[y];
+        }
+        d->S[i] = k - d->beg[i];
+        if (p->S[i] >= INACTIVE) {
+            d->S[i] += INACTIVE;
+            if (a[c].L != c || p->S[i] >= 2 * INACTIVE) d->S[i] += DONE;
+        }
+    }
+    free(node);
+    return d;
+}
+
+static void dc_free(struct cells_s *d) {
+    if (!d) return;
+    free(d->node);
+    free(d->ncolor);
+    free(d->opt);
+    free(d->set);
+    free(d->ostart);
+    free(d->orow);
+    free(d->S);
+    free(d->beg);
+    free(d->color);
+    free(d->stamp);
+    free(d->trail);
+    free(d);
+}
+
+static int dc_len(struct cells_s *d, int m) { return d->S[m] & (INACTIVE - 1); }
+
+static void dc_push(struct cells_s *d, int m, int S) {
+    if (d->trailn == d->trail_alloc) {
+        d->trail = realloc(d->trail, sizeof(*d->trail) * (d->trail_alloc *= 2));
+    }
+    d->trail[d->trailn++] = (struct dc_trail) { m, S };
+}
+
+// Returns the trail's length, after which changes can be undone.
+static int dc_checkpoint(struct cells_s *d) {
+    d->epoch++;
+    return d->trailn;
+}
+
+static void dc_undo(struct cells_s *d, int t) {
+    while (d->trailn > t) {
+        struct dc_trail *e = d->trail + --d->trailn;
+        if (e->m >= 0) d->S[e->m] = e->S; else d->color[~e->m] = 0;
+    }
+}
+
+// Takes the live options of item m, or those that disagree with the given
+// color, out of every other item still in play. As with the links, a live
+// option is in the slice of every item it has that is still in play, and
+// leaves them all at once, except that options purified away linger in the
+// purified item's own slice, which is never walked again.
+static void dc_purge(struct cells_s *d, int m, int color) {
+    int *set = d->set, *S = d->S, *beg = d->beg;
+    struct dc_node *node = d->node;
+    int end = beg[m] + dc_len(d, m);
+    for (int k = beg[m]; k < end; k++) {
+        int y = set[k], x = d->opt[y];
+        if (color && d->ncolor[y] == color) continue;
+        for (int z = d->ostart[x]; z < d->ostart[x + 1]; z++) {
+            int j = node[z].item, len = S[j] & (INACTIVE - 1);
+            if (z == y || S[j] & DONE) continue;
+            if (d->stamp[j] != d->epoch) {
+                d->stamp[j] = d->epoch;
+                dc_push(d, j, S[j]);
+            }
+            // Swap z with the last live node.
+            int last = beg[j] + len - 1, w = set[last];
+            set[node[z].loc] = w, node[w].loc = node[z].loc;
+            set[last] = z, node[z].loc = last;
+            S[j]--;
+            MEMS(1);
+        }
+    }
+}
+
+static void dc_cover(struct cells_s *d, int m) {
+    dc_push(d, m, d->S[m]);
+    d->S[m] |= DONE | INACTIVE;
+}
+
+// Chooses option x, whose item 'skip' has been covered already. Like
+// commit(), deals with the other items one at a time.
+static void dc_select(struct cells_s *d, int x, int skip) {
+    struct dc_node *node = d->node;
+    for (int z = d->ostart[x]; z < d->ostart[x + 1]; z++) {
+        int m = node[z].item;
+        if (m == skip) continue;
+        if (!d->ncolor[z]) {
+            dc_cover(d, m);
+            dc_purge(d, m, 0);
+        } else if (!d->color[m]) {
+            d->color[m] = d->ncolor[z];
+            dc_push(d, ~m, 0);
+            dc_purge(d, m, d->color[m]);
+        }
+    }
+}
+
+// Bitsets, for instances with few columns. Each row is a bitset of its
+// columns, and each level keeps the list of rows still compatible with those
+// chosen above it, in row order. Choosing a row filters the list with an AND
+// per word. Column sizes are kept bit-sliced: bitset k holds bit k of every
+// column's size, so adding a row is a carry-save addition, and the first
+// column of least size is found with a few ANDs per bit. Rows are tried in
+// list order, so the solutions come in the same order as with the links as
+// long as every column's rows are in row order.
+// Filtering every row in play costs more than dancing past the few that
+// clash once rows are sparse, as in a sudoku's 324 columns, so DLX_AUTO only
+// picks bitsets for narrow instances.
+enum { BITS_MAX_WORDS = 8, BITS_MAX = 64 * BITS_MAX_WORDS, BITS_AUTO = 128 };
+
+struct bits_s {
+    int w;          // Words per bitset: 1, 2, 4 or 8.
+    int m;          // Rows still in play when the search started.
+    uint64_t *row;  // w words for each of them.
+    int *rowno;     // Their row numbers.
+    uint64_t *need; // Primary columns not covered when the search started.
+    uint64_t *cov;  // Columns covered at each level, w words each.
+    int *live, live_alloc;  // The levels' lists of rows, one after another.
+    int digits;     // Bits in a size.
+    uint64_t *size; // Bit-sliced sizes of the columns at the newest level.
+};
+
+// Returns bitsets for a search of p, or NULL if a column's rows are out of
+// order.
+static struct bits_s *bits_new(dlx_t p) {
+    cell_ptr a = p->cell;
+    F(i, p->ctabn) {
+        link_t c = p->ctab[i];
+        C(y, c, D) if (a[y].D != c && a[a[y].D].n <= a[y].n) return 0;
+    }
+    struct bits_s *b = malloc(sizeof(*b));
+    int w = 1;
+    while (64 * w < p->ctabn) w *= 2;
+    b->w = w;
+    b->m = 0;
+    b->row = malloc(sizeof(uint64_t) * w * (p->rtabn + 1));
+    b->rowno = malloc(sizeof(int) * (p->rtabn + 1));
+    F(i, p->rtabn) {
+        link_t r = p->rtab[i];
+        if (!r || !row_live(p, r)) continue;
+        uint64_t *x = b->row + w * b->m;
+        F(k, w) x[k] = 0;
+        int col = a[a[r].c].n;
+        x[col / 64] |= 1ull << col % 64;
+        C(k, r, R) col = a[a[k].c].n, x[col / 64] |= 1ull << col % 64;
+        b->rowno[b->m++] = i;
+    }
+    b->need = calloc(w, sizeof(uint64_t));
+    F(i, p->ctabn) if (p->S[i] < INACTIVE) b->need[i / 64] |= 1ull << i % 64;
+    b->cov = calloc((p->ctabn + 1) * w, sizeof(uint64_t));
+    b->live_alloc = 2 * b->m + 64;
+    b->live = malloc(sizeof(int) * b->live_alloc);
+    b->digits = 1;
+    while (1 << b->digits <= b->m) b->digits++;
+    b->size = malloc(sizeof(uint64_t) * w * b->digits);
+    return b;
+}
+
+static void bits_free(struct bits_s *b) {
+    if (!b) return;
+    free(b->row);
+    free(b->rowno);
+    free(b->need);
+    free(b->cov);
+    free(b->live);
+    free(b->size);
+    free(b);
+}
+
+// Adds the columns of row x to the sizes.
+static inline __attribute__((always_inline))
+void bits_add(uint64_t *size, const uint64_t *x, int w) {
+    F(k, w) for (uint64_t carry = x[k], *d = size + k; carry; d += w) {
+        uint64_t t = *d & carry;
+        *d ^= carry;
+        carry = t;
+    }
+}
+
+// Copies the rows of live[lo..hi) that miss the columns in 'mask' to
+// live[hi..), adding up their sizes, and returns the end of the new list.
+static inline __attribute__((always_inline))
+int bits_filter_w(struct bits_s *b, int lo, int hi, const uint64_t *mask, int w) {
+    int *live = b->live, n = hi;
+    MEMS(hi - lo);
+    memset(b->size, 0, sizeof(uint64_t) * w * b->digits);
+    for (int i = lo; i < hi; i++) {
+        const uint64_t *x = b->row + w * live[i];
+        uint64_t t = 0;
+        F(k, w) t |= x[k] & mask[k];
+        if (t) continue;
+        live[n++] = live[i];
+        bits_add(b->size, x, w);
+    }
+    return n;
+}
+
+#if defined(__x86_64__) && defined(__GNUC__) && !defined(__clang__)
+#define BITS_CLONES __attribute__((target_clones("avx2", "default")))
+#else
+#define BITS_CLONES
+#endif
+
+// Instantiated for each width, so the loops over words can be unrolled and,
+// where the processor has AVX2, vectorized.
+BITS_CLONES
+static int bits_filter(struct bits_s *b, int lo, int hi, const uint64_t *mask) {
+    switch (b->w) {
+    case 1: return bits_filter_w(b, lo, hi, mask, 1);
+    case 2: return bits_filter_w(b, lo, hi, mask, 2);
+    case 4: return bits_filter_w(b, lo, hi, mask, 4);
+    default: return bits_filter_w(b, lo, hi, mask, 8);
+    }
+}
+
+// Returns the first of the given columns of least size, storing the size in
+// *n, or -1 if there are none.
+static int bits_choose(struct bits_s *b, const uint64_t *cols, int *n) {
+    int w = b->w;
+    uint64_t cand[BITS_MAX_WORDS], t[BITS_MAX_WORDS], any = 0;
+    F(k, w) any |= cand[k] = cols[k];
+    if (!any) return -1;
+    // Keep the columns whose size has a 0 at each bit, from the top down,
+    // whenever some do.
+    for (int d = b->digits - 1; d >= 0; d--) {
+        any = 0;
+        F(k, w) any |= t[k] = cand[k] & ~b->size[d * w + k];
+        if (any) F(k, w) cand[k] = t[k];
+    }
+    int k = 0;
+    while (!cand[k]) k++;
+    int col = 64 * k + __builtin_ctzll(cand[k]);
+    *n = 0;
+    F(d, b->digits) *n |= (int)(b->size[d * w + k] >> col % 64 & 1) << d;
+    return col;
+}
+
+// The search engine. Rather than recursing, it keeps an explicit stack with
+// the column chosen and the row being tried at each level, so a search can be
+// suspended between solutions and its memory is bounded by the number of
+// columns: every row picked covers at least one column.
+struct level_s {
+    link_t c, r;
+    int s;    // Size of column c when it was chosen.
+    int cut;  // Set to skip the remaining rows of this level.
+    int i, end;  // Position of r among the level's candidates, if ordered.
+    link_t ft;  // First row tweaked, in a search with bounds.
+    // With dancing cells, c is a column number and i the position of the row
+    // in its slice, and the trail's length before the column was covered and
+    // before the row was chosen.
+    int tcol, trow;
+    // With bitsets, c is a column number, and i the position of the row in
+    // the level's list live[lo..end).
+    int lo;
+};
+
+// Returns a bound on the number of levels of a search. Every row chosen
+// covers a column, except that with bounds a column may take several rows,
+// then one more level to take no more.
+static int max_depth(dlx_t p) {
+    if (!p->bound) return p->ctabn;
+    int n = 0;
+    F(i, p->ctabn) n += p->bound[i] + 1;
+    return n;
+}
+
+struct search_s {
+    cell_ptr a;
+    int *S;
+    link_t *ctab;
+    int ncol;
+    int *W;  // Column weights, if choosing by DLX_WDEG.
+    // Unless rows are tried in insertion order, each level's rows are sorted
+    // into 'cand' when the level is entered, after those of the level above.
+    // A row can be a candidate on only one level at a time, so one slot per
+    // row is enough.
+    int order;
+    link_t *cand;
+    uint64_t *key, rng;
+    int ties;  // Set to break ties between columns at random, with rng.
+    int out;   // Set once a randomized run has used up its nodes.
+    int *B, *slack;  // From dlx_set_bounds(), if called.
+    // From dlx_add_symmetry(), with a flag per row for those being tried,
+    // and rows picked before the search that count as tried: those of a
+    // parallel job, and those forced. Rows are compared in the order 'ord',
+    // which starts with those of column sym_col if it is not -1.
+    int **sym, symn;
+    link_t *rtab;
+    char *in;
+    const int *pre, *forced;
+    int pren, forcedn;
+    int *ord, ordn, sym_col;
+    struct cells_s *dc;  // If dancing on cells rather than links.
+    struct bits_s *bs;   // If searching on bitsets.
+    struct level_s *lev;
+    int n;       // Number of levels with a row being tried.
+    int cap;     // If not -1, nodes this deep count as leaves, on links.
+    int resume;  // Set once search_next() has returned a solution.
+    void (*try_cb)(int, int, int);
+    void (*undo_cb)(void);
+    void (*stuck_cb)(int);
+    // Called whenever 'nodes' reaches 'tick_at', so callers can do periodic
+    // work without a test of their own on every node.
+    long long nodes, tick_at;
+    void (*tick)(struct search_s *);
+    // Where to count, if keeping statistics. Nodes on level n are at depth
+    // depth0 + n, and the time since t is charged to depth td.
+    struct dlx_stats_s *st;
+    int depth0, td;
+    double t, t0;
+    long long mems0;
+    // From dlx_set_progress(), for a serial search.
+    void (*progress)(double, long long);
+    long long every, progress_at;
+    // The instance, if the search writes checkpoints of itself, when it next
+    // does, and the solutions it has found. The counts of a run it resumed
+    // carry on from where they were.
+    dlx_t ckpt;
+    long long ckpt_at, found, found0, nodes0;
+};
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// Empties st, with room for n depths.
+static void stats_clear(struct dlx_stats_s *st, int n) {
+    stats_free(st);
+    *st = (struct dlx_stats_s) {
+#ifndef DLX_STATS
+        .mems = -1,
+#endif
+        .nodes_at = calloc(n, sizeof(long long)),
+        .solutions_at = calloc(n, sizeof(long long)),
+        .seconds_at = calloc(n, sizeof(double)),
+    };
+}
+
+// Adds the counts of st to those of sum, which has room for as many depths.
+static void stats_add(struct dlx_stats_s *sum, const struct dlx_stats_s *st) {
+    sum->nodes += st->nodes;
+    if (sum->mems >= 0) sum->mems += st->mems;
+    sum->stuck += st->stuck;
+    sum->solutions += st->solutions;
+    if (st->depth > sum->depth) sum->depth = st->depth;
+    F(i, st->depth) {
+        sum->nodes_at[i] += st->nodes_at[i];
+        sum->solutions_at[i] += st->solutions_at[i];
+        sum->seconds_at[i] += st->seconds_at[i];
+    }
+    F(i, DLX_STATS_BRANCH) sum->branch[i] += st->branch[i];
+}
+
+// Starts counting the nodes of s in st, on the calling thread.
+static void stats_start(struct search_s *s, struct dlx_stats_s *st) {
+    s->st = st;
+    s->t = s->t0 = now();
+    s->td = s->depth0 = 0;
+#ifdef DLX_STATS
+    s->mems0 = mems;
+#endif
+}
+
+// Stops counting, charging the time since the last node to its depth.
+static void stats_stop(struct search_s *s) {
+    struct dlx_stats_s *st = s->st;
+    double t = now();
+    st->seconds_at[s->td] += t - s->t;
+    st->seconds += t - s->t0;
+#ifdef DLX_STATS
+    st->mems += mems - s->mems0;
+#endif
+    s->st = 0;
+}
+
+// Returns the fraction of the search tree explored, judging by the position
+// of each level's row among its column's rows. Every subtree counts as equal,
+// so this is only a rough guide, but it only ever goes up.
+static double search_done(struct search_s *s) {
+    cell_ptr a = s->a;
+    double done = 0, w = 1;
+    for (int i = 0; i < s->n && w > 1e-12; i++) {
+        struct level_s *l = s->lev + i;
+        int k = 0, n = l->s;
+        if (s->bs) {
+            struct bits_s *b = s->bs;
+            for (int j = l->lo; j < l->i; j++) {
+                k += b->row[b->w * b->live[j] + l->c / 64] >> l->c % 64 & 1;
+            }
+        } else if (s->dc) {
+            k = l->i - s->dc->beg[l->c];
+        } else if (s->order) {
+            k = l->i - (i ? l[-1].end : 0);
+        } else {
+            C(r, l->c, D) if (r == l->r) break; else k++;
+        }
+        done += w * k / n;
+        w /= n;
+    }
+    return done;
+}
+
+// Counts a node, on entering it. Its time runs until the next node.
+static void stats_node(struct search_s *s) {
+    struct dlx_stats_s *st = s->st;
+    int d = s->depth0 + s->n;
+    double t = now();
+    st->seconds_at[s->td] += t - s->t;
+    s->t = t, s->td = d;
+    st->nodes++;
+    st->nodes_at[d]++;
+    if (d >= st->depth) st->depth = d + 1;
+}
+
+// Counts a node that branches k ways.
+static void stats_branch(struct search_s *s, int k) {
+    s->st->branch[k < DLX_STATS_BRANCH ? k : DLX_STATS_BRANCH - 1]++;
+    if (!k) s->st->stuck++;
+}
+
+static void search_node(struct search_s *s) {
+    if (++s->nodes >= s->tick_at) s->tick(s);
+    if (s->st) stats_node(s);
+}
+
+// Any order of the rows will do for lex-leader pruning, but the sooner the
+// search settles the first rows, the sooner it prunes. So the rows of the
+// column with fewest rows that every symmetry maps to itself come first, and
+// the search branches on that column first: from then on, only the rows of
+// that column least in their orbits are tried.
+static void sym_init(struct search_s *s, dlx_t p) {
+    cell_ptr a = s->a;
+    int m = p->rtabn, k = 0;
+    char *mark = s->in = calloc(m, 1);  // Borrowed for now.
+    s->ord = malloc(sizeof(int) * m);
+    s->sym_col = -1;
+    if (p->sym_ord) {
+        // A job searches as the split that made it did.
+        s->sym_col = p->sym_col;
+        for (; k < p->sym_ordn; k++) mark[s->ord[k] = p->sym_ord[k]] = 1;
+    } else {
+        C(c, root, R) {
+            if (s->sym_col >= 0 && s->S[a[c].n] >= s->S[s->sym_col]) continue;
+            C(y, c, D) mark[a[y].n] = 1;
+            int stable = 1;
+            F(j, s->symn) {
+                int n = s->sym[j][0], *inv = s->sym[j] + 1;
+                C(y, c, D) if (a[y].n < n && !mark[inv[a[y].n]]) stable = 0;
+            }
+            C(y, c, D) mark[a[y].n] = 0;
+            if (stable) s->sym_col = a[c].n;
+        }
+        if (s->sym_col >= 0) {
+            C(y, s->ctab[s->sym_col], D) s->ord[k++] = a[y].n, mark[a[y].n] = 1;
+        }
+    }
+    F(i, m) if (!mark[i]) s->ord[k++] = i;
+    F(i, m) mark[i] = 0;
+    s->ordn = k;
+}
+
+// Makes the search s of p try rows in the given order, with the given seed.
+static void search_order_init(struct search_s *s, dlx_t p, int order, uint64_t seed) {
+    s->order = order;
+    s->cand = malloc(sizeof(link_t) * (p->rtabn + 1));
+    s->key = malloc(sizeof(uint64_t) * (p->rtabn + 1));
+    s->rng = seed;
+}
+
+// Sets up a search of p, dancing on the links a and sizes S, which are either
+// p's own or a copy of them.
+static void search_init(struct search_s *s, dlx_t p, cell_ptr a, int *S) {
+    *s = (struct search_s) {
+        .a = a, .S = S, .ctab = p->ctab, .ncol = p->ctabn, .tick_at = LLONG_MAX,
+        .B = p->bound, .slack = p->slack,
+        .sym = p->sym, .symn = p->symn, .rtab = p->rtab, .sym_col = -1,
+        .forced = p->forced, .forcedn = p->forcedn, .cap = -1,
+    };
+    if (s->symn) sym_init(s, p);
+    s->lev = malloc(sizeof(*s->lev) * (max_depth(p) + 1));
+    if (p->strategy == DLX_WDEG) {
+        s->W = malloc(sizeof(int) * p->ctabn);
+        F(i, p->ctabn) s->W[i] = 1;
+    }
+    if (p->row_order != DLX_ORDER_INSERTION) search_order_init(s, p, p->row_order, p->seed);
+}
+
+// Switches a search of p to dancing cells or bitsets as p asks, unless it
+// uses something only the links have.
+static void search_engine(struct search_s *s, dlx_t p) {
+    if (p->bound || s->order || s->symn) return;
+    if (p->backend == DLX_CELLS && !p->ckpt && !p->replay) {
+        // Dancing cells shuffle the rows of a column as they go, so their
+        // search positions cannot be replayed; links can.
+        s->dc = dc_new(p);
+    } else if (!p->colors && !s->W && (p->backend == DLX_BITS ?
+            p->ctabn <= BITS_MAX : p->backend == DLX_AUTO && p->ctabn <= BITS_AUTO)) {
+        s->bs = bits_new(p);
+    }
+}
+
+static void search_free(struct search_s *s) {
+    if (s->st) stats_stop(s);
+    dc_free(s->dc);
+    bits_free(s->bs);
+    free(s->in);
+    free(s->ord);
+    free(s->key);
+    free(s->cand);
+    free(s->W);
+    free(s->lev);
+}
+
+// Sorts into decreasing order.
+static int key_cmp(const void *x, const void *y) {
+    uint64_t a = *(uint64_t *)x, b = *(uint64_t *)y;
+    return (a < b) - (a > b);
+}
+
+// Fills in the candidates of a new level l, whose column has been covered,
+// and points it at the first.
+static void search_order(struct search_s *s, struct level_s *l) {
+    cell_ptr a = s->a;
+    if (!s->order) {
+        l->r = a[l->c].D;
+        return;
+    }
+    link_t *cand = s->cand;
+    int n = l == s->lev ? 0 : l[-1].end, start = n;
+    C(r, l->c, D) cand[n++] = r;
+    if (s->order == DLX_ORDER_RANDOM) {
+        for (int i = n - 1; i > start; i--) {
+            int j = start + rng_next(&s->rng) % (i - start + 1);
+            link_t t = cand[i];
+            cand[i] = cand[j], cand[j] = t;
+        }
+    } else {
+        // Least constraining first: the larger the other columns of a row,
+        // the more choices it leaves. Sort on the total, then on position so
+        // that ties keep insertion order.
+        uint64_t *key = s->key;
+        for (int i = start; i < n; i++) {
+            uint64_t sum = 0;
+            C(j, cand[i], R) sum += s->S[a[a[j].c].n] & (INACTIVE - 1);
+            key[i] = sum << 32 | (uint32_t)~(i - start);
+        }
+        qsort(key + start, n - start, sizeof(*key), key_cmp);
+        for (int i = start; i < n; i++) key[i] = cand[start + ~(uint32_t)key[i]];
+        for (int i = start; i < n; i++) cand[i] = key[i];
+    }
+    l->i = start;
+    l->end = n;
+    l->r = cand[start];
+}
+
+// Moves level l to its next row, or to its column header if there is none.
+static link_t search_step(struct search_s *s, struct level_s *l) {
+    if (!s->order) return l->r = s->a[l->r].D;
+    return l->r = ++l->i < l->end ? s->cand[l->i] : l->c;
+}
+
+// Starts trying the row at the top of the stack.
+static void search_try(struct search_s *s, struct level_s *l) {
+    cell_ptr a = s->a;
+    if (s->try_cb) s->try_cb(a[l->c].n, l->s, a[l->r].n);
+    C(j, l->r, R) commit(a, s->S, j);
+}
+
+// Returns 1 if row i is among those being tried, 0 if it can no longer join
+// them, and -1 if it might. Once they form an exact cover, no other can.
+static int sym_row(struct search_s *s, int i, int done) {
+    if (s->in[i]) return 1;
+    link_t r = s->rtab[i];
+    return !r || done || !cell_live(s->a, s->S, r) ? 0 : -1;
+}
+
+// Lex-leader pruning. Of the sets of rows equivalent under the symmetries,
+// only the least is wanted, comparing sets by the first row in 'ord' that
+// one has and the other lacks: that one is the lesser. Returns 0 if every
+// exact cover with the rows being tried is greater than its image under some
+// symmetry, judging by rows already known to be in or out.
+static int sym_ok(struct search_s *s, int done) {
+    cell_ptr a = s->a;
+    F(i, s->pren) s->in[s->pre[i]] = 1;
+    F(i, s->forcedn) s->in[s->forced[i]] = 1;
+    F(i, s->n) if (s->lev[i].r != s->lev[i].c) s->in[a[s->lev[i].r].n] = 1;
+    int ok = 1;
+    for (int k = 0; ok && k < s->symn; k++) {
+        int n = s->sym[k][0], *inv = s->sym[k] + 1;
+        // The image has row i if the set has inv[i].
+        F(j, s->ordn) {
+            int i = s->ord[j];
+            if (i >= n || inv[i] == i) continue;
+            int x = sym_row(s, i, done), y = sym_row(s, inv[i], done);
+            if (x == y && x >= 0) continue;
+            ok = x || y <= 0;
+            break;
+        }
+    }
+    F(i, s->pren) s->in[s->pre[i]] = 0;
+    F(i, s->forcedn) s->in[s->forced[i]] = 0;
+    F(i, s->n) if (s->lev[i].r != s->lev[i].c) s->in[a[s->lev[i].r].n] = 0;
+    return ok;
+}
+
+// Backtracks to the next untried row. Returns 0 once there is none.
+static int search_advance(struct search_s *s) {
+    cell_ptr a = s->a;
+    while (s->n) {
+        struct level_s *l = s->lev + s->n - 1;
+        if (s->undo_cb) s->undo_cb();
+        C(j, l->r, L) uncommit(a, s->S, j);
+        if (search_step(s, l) != l->c && !l->cut) {
+            search_try(s, l);
+            return 1;
+        }
+        uncover_col(a, s->S, l->c);
+        s->n--;
+    }
+    return 0;
+}
+
+// Knuth's Algorithm M, for columns that must be covered between lo and hi
+// times. A level for column c either tries a row or, as its last choice,
+// the column header itself, meaning c takes no more rows. B[col] counts how
+// many more rows the column may take, and B[col] - slack[col] how many it
+// still needs. A row that has been tried is tweaked: hidden and taken out
+// of the column, so deeper levels cannot choose it again.
+static void tweak(struct search_s *s, link_t c, link_t x, int hide) {
+    cell_ptr a = s->a;
+    if (hide) hide_row(a, s->S, x);
+    link_t d = a[x].D;
+    a[c].D = d, a[d].U = c;
+    s->S[a[c].n]--;
+}
+
+// Puts back the rows tweaked at level l, which still link to each other.
+static void untweak(struct search_s *s, struct level_s *l, int unhide) {
+    cell_ptr a = s->a;
+    link_t c = l->c, x = l->ft, y = c, z = a[c].D;
+    int k = 0;
+    a[c].D = x;
+    for (; x != z; y = x, x = a[x].D) {
+        a[x].U = y;
+        k++;
+        if (unhide) unhide_row(a, s->S, x);
+    }
+    a[z].U = y;
+    s->S[a[c].n] += k;
+}
+
+// Undoes the choice of column l->c, once its level has run out of choices.
+static void mrestore(struct search_s *s, struct level_s *l) {
+    int col = s->a[l->c].n;
+    if (!s->B[col] && !s->slack[col]) {
+        uncover_col(s->a, s->S, l->c);
+    } else if (!s->B[col]) {
+        untweak(s, l, 0);
+        uncover_col(s->a, s->S, l->c);
+    } else {
+        untweak(s, l, 1);
+    }
+    s->B[col]++;
+}
+
+static int msearch_next(struct search_s *s) {
+    cell_ptr a = s->a;
+    int *S = s->S, *B = s->B, *slack = s->slack, col;
+    struct level_s *l;
+    if (s->resume) goto backtrack;
+    s->resume = 1;
+enter:
+    search_node(s);
+    if (s->symn && !sym_ok(s, a[root].R == root)) goto backtrack;
+    if (a[root].R == root) return 1;
+    {
+        // Choose the column with the fewest choices: its rows, plus leaving
+        // it alone, less those it needs.
+        int theta = INT_MAX;
+        link_t c = root;
+        C(i, root, R) {
+            int need = B[a[i].n] - slack[a[i].n];
+            int t = S[a[i].n] + 1 - (need > 0 ? need : 0);
+            if (t < theta) theta = t, c = i;
+        }
+        col = a[c].n;
+        if (s->st) stats_branch(s, theta > 0 ? theta : 0);
+        if (theta <= 0) {
+            if (s->stuck_cb) s->stuck_cb(col);
+            goto backtrack;
+        }
+        l = s->lev + s->n;
+        *l = (struct level_s) { .c = c, .r = a[c].D, .s = S[col] };
+        if (!--B[col]) cover_col(a, S, c);
+        l->ft = l->r;
+    }
+next:
+    col = a[l->c].n;
+    if (!B[col] && !slack[col]) {
+        if (l->r == l->c) goto restore;
+    } else if ((S[col] & (INACTIVE - 1)) <= B[col] - slack[col]) {
+        goto restore;  // Too few rows left.
+    } else if (l->r != l->c) {
+        tweak(s, l->c, l->r, B[col]);
+    } else if (B[col]) {
+        LR_delete(a, l->c);  // No more rows for this column.
+    }
+    if (l->r != l->c) {
+        if (s->try_cb) s->try_cb(col, l->s, a[l->r].n);
+        mcommit_row(a, S, B, l->r);
+    }
+    s->n++;
+    goto enter;
+retry:
+    if (s->undo_cb) s->undo_cb();
+    muncommit_row(a, S, B, l->r);
+    l->r = a[l->r].D;
+    goto next;
+restore:
+    mrestore(s, l);
+backtrack:
+    if (!s->n) return 0;
+    l = s->lev + --s->n;
+    if (l->r != l->c) goto retry;
+    LR_restore(a, l->c);
+    goto restore;
+}
+
+// Starts trying the row at position l->i of the level's slice.
+static void dc_try(struct search_s *s, struct level_s *l) {
+    struct cells_s *d = s->dc;
+    int x = d->opt[d->set[l->i]];
+    if (s->try_cb) s->try_cb(l->c, l->s, d->orow[x]);
+    dc_select(d, x, l->c);
+}
+
+static int dc_advance(struct search_s *s) {
+    struct cells_s *d = s->dc;
+    while (s->n) {
+        struct level_s *l = s->lev + s->n - 1;
+        if (s->undo_cb) s->undo_cb();
+        dc_undo(d, l->trow);
+        d->epoch++;
+        if (++l->i < l->end && !l->cut) {
+            dc_try(s, l);
+            return 1;
+        }
+        dc_undo(d, l->tcol);
+        s->n--;
+    }
+    return 0;
+}
+
+// Like search_next(), dancing on cells. A covered column's slice is left
+// alone until the column is uncovered, so its rows can be tried in place.
+static int dc_next(struct search_s *s) {
+    struct cells_s *d = s->dc;
+    if (s->resume && !dc_advance(s)) return 0;
+    s->resume = 1;
+    for (;;) {
+        search_node(s);
+        int col = s->W ? wdeg_col(d->S, s->W, d->n) : min_col(d->S, d->n);
+        if (col == d->n) return 1;
+        int size = d->S[col];
+        if (s->st) stats_branch(s, size);
+        if (!size) {
+            if (s->W) s->W[col]++;
+            if (s->stuck_cb) s->stuck_cb(col);
+            if (!dc_advance(s)) return 0;
+            continue;
+        }
+        struct level_s *l = s->lev + s->n++;
+        *l = (struct level_s) {
+            .c = col, .s = size, .i = d->beg[col], .end = d->beg[col] + size,
+            .tcol = dc_checkpoint(d),
+        };
+        dc_cover(d, col);
+        dc_purge(d, col, 0);
+        l->trow = dc_checkpoint(d);
+        dc_try(s, l);
+    }
+}
+
+// Tries the next row of level l with its column, if any. Returns 0 if there
+// is none.
+static int bits_try(struct search_s *s, struct level_s *l) {
+    struct bits_s *b = s->bs;
+    int w = b->w, c = l->c;
+    const uint64_t *x;
+    do {
+        if (++l->i == l->end || l->cut) return 0;
+        x = b->row + w * b->live[l->i];
+    } while (!(x[c / 64] >> c % 64 & 1));
+    if (s->try_cb) s->try_cb(c, l->s, b->rowno[b->live[l->i]]);
+    int n = l - s->lev;
+    uint64_t *cov = b->cov + w * n;
+    F(k, w) cov[w + k] = cov[k] | x[k];
+    // Make room for a list as long as this one.
+    int need = 2 * l->end - l->lo;
+    if (need > b->live_alloc) {
+        b->live = realloc(b->live, sizeof(int) * (b->live_alloc = 2 * need));
+    }
+    l[1].lo = l->end;
+    l[1].end = bits_filter(b, l->lo, l->end, x);
+    return 1;
+}
+
+static int bits_advance(struct search_s *s) {
+    while (s->n) {
+        struct level_s *l = s->lev + s->n - 1;
+        if (s->undo_cb) s->undo_cb();
+        if (bits_try(s, l)) return 1;
+        s->n--;
+    }
+    return 0;
+}
+
+// Like search_next(), on bitsets. The list and sizes for a new level are
+// made when the row above it is chosen.
+// Sets up the root of a search on bitsets.
+static void bits_root(struct search_s *s) {
+    struct bits_s *b = s->bs;
+    // Every row, filtered by nothing to get the sizes.
+    uint64_t none[BITS_MAX_WORDS] = { 0 };
+    F(i, b->m) b->live[i] = i;
+    s->lev[0].lo = b->m;
+    s->lev[0].end = bits_filter(b, 0, b->m, none);
+}
+
+static int bits_next(struct search_s *s) {
+    struct bits_s *b = s->bs;
+    int w = b->w;
+    if (s->resume) {
+        if (!bits_advance(s)) return 0;
+    } else if (!s->n) {
+        // Unless the search resumed below the root.
+        bits_root(s);
+    }
+    s->resume = 1;
+    for (;;) {
+        search_node(s);
+        struct level_s *l = s->lev + s->n;
+        uint64_t cols[BITS_MAX_WORDS], *cov = b->cov + w * s->n;
+        F(k, w) cols[k] = b->need[k] & ~cov[k];
+        int size, col = bits_choose(b, cols, &size);
+        if (col < 0) return 1;
+        if (s->st) stats_branch(s, size);
+        if (!size) {
+            if (s->stuck_cb) s->stuck_cb(col);
+            if (!bits_advance(s)) return 0;
+            continue;
+        }
+        l->c = col, l->s = size, l->cut = 0, l->i = l->lo - 1;
+        s->n++;
+        if (!bits_try(s, l) && !bits_advance(s)) return 0;
+    }
+}
+
+// Chooses the column to branch on, on links.
+static int search_col(struct search_s *s) {
+    if (!s->n && s->sym_col >= 0 && s->S[s->sym_col] < INACTIVE) return s->sym_col;
+    if (s->W) return wdeg_col(s->S, s->W, s->ncol);
+    // S-heuristic: choose first most-constrained column.
+    if (!s->ties) return min_col(s->S, s->ncol);
+    return rand_min_col(s->S, s->ncol, &s->rng);
+}
+
+static int links_next(struct search_s *s) {
+    cell_ptr a = s->a;
+    if (s->resume && !search_advance(s)) return 0;
+    s->resume = 1;
+    for (;;) {
+        search_node(s);
+        if (s->symn && !sym_ok(s, a[root].R == root)) {
+            if (!search_advance(s)) return 0;
+            continue;
+        }
+        if (a[root].R == root || s->n == s->cap) return 1;
+        int col = search_col(s);
+        int size = s->S[col];
+        link_t c = s->ctab[col];
+        if (s->st) stats_branch(s, size);
+        if (!size) {
+            if (s->W) s->W[col]++;
+            if (s->stuck_cb) s->stuck_cb(col);
+            if (!search_advance(s)) return 0;
+            continue;
+        }
+        cover_col(a, s->S, c);
+        struct level_s *l = s->lev + s->n++;
+        *l = (struct level_s) { .c = c, .s = size };
+        search_order(s, l);
+        search_try(s, l);
+    }
+}
+
+// Copies the row numbers of the current solution into sol. With bounds, a
+// level may have chosen no row.
+static int search_rows(struct search_s *s, int *sol) {
+    int n = 0;
+    if (s->bs) {
+        struct bits_s *b = s->bs;
+        F(i, s->n) sol[n++] = b->rowno[b->live[s->lev[i].i]];
+        return n;
+    }
+    if (s->dc) {
+        struct cells_s *d = s->dc;
+        F(i, s->n) sol[n++] = d->orow[d->opt[d->set[s->lev[i].i]]];
+        return n;
+    }
+    F(i, s->n) if (s->lev[i].r != s->lev[i].c) sol[n++] = s->a[s->lev[i].r].n;
+    return n;
+}
+
+// Writes the position of the search to p's checkpoint file: the row being
+// tried on each level, and the counts so far. A new file replaces the old
+// one by renaming, so a crash leaves one or the other whole.
+static void checkpoint(dlx_t p, struct search_s *s, int state) {
+    int rows[s->n + 1], n = state == RESUME_DONE ? 0 : search_rows(s, rows);
+    char tmp[strlen(p->ckpt) + 5];
+    sprintf(tmp, "%s.tmp", p->ckpt);
+    FILE *fp = fopen(tmp, "w");
+    if (!fp) return;
+    fprintf(fp, "# dlx checkpoint: %d rows, %d columns\n", p->rtabn, p->ctabn);
+    fprintf(fp, "%lld solutions, %lld nodes\n", s->found0 + s->found, s->nodes0 + s->nodes);
+    fprintf(fp, "%s %d:", resume_state[state], n);
+    F(i, n) fprintf(fp, " %d", rows[i]);
+    fputc('\n', fp);
+    int err = fflush(fp) || fsync(fileno(fp));
+    if (fclose(fp) || err || rename(tmp, p->ckpt)) remove(tmp);
+}
+
+// Takes a fresh search on links or bitsets down to the node whose rows are
+// given, one per level, choosing columns as the search does. Links and
+// bitsets order columns and rows alike, so either can replay the other's
+// checkpoints. Returns 0, leaving the levels that did replay, if the rows
+// lead nowhere the search goes.
+static int search_replay(struct search_s *s, const int *rows, int n) {
+    cell_ptr a = s->a;
+    if (s->bs) bits_root(s);
+    F(k, n) {
+        if (s->bs) {
+            struct bits_s *b = s->bs;
+            struct level_s *l = s->lev + s->n;
+            uint64_t cols[BITS_MAX_WORDS], *cov = b->cov + b->w * s->n;
+            F(j, b->w) cols[j] = b->need[j] & ~cov[j];
+            int size, col = bits_choose(b, cols, &size);
+            if (col < 0 || !size) return 0;
+            l->c = col, l->s = size, l->cut = 0, l->i = l->lo - 1;
+            s->n++;
+            do {
+                if (!bits_try(s, l)) return s->n--, 0;
+            } while (b->rowno[b->live[l->i]] != rows[k]);
+        } else {
+            if (a[root].R == root) return 0;
+            int col = search_col(s), size = s->S[col];
+            link_t c = s->ctab[col];
+            if (!size) return 0;
+            cover_col(a, s->S, c);
+            struct level_s *l = s->lev + s->n++;
+            *l = (struct level_s) { .c = c, .s = size };
+            search_order(s, l);
+            while (a[l->r].n != rows[k]) {
+                if (search_step(s, l) == c) {
+                    uncover_col(a, s->S, c);
+                    return s->n--, 0;
+                }
+            }
+            search_try(s, l);
+        }
+    }
+    return 1;
+}
+
+// Reports progress and writes checkpoints, whichever is due.
+static void watch_tick(struct search_s *s) {
+    s->tick_at = LLONG_MAX;
+    if (s->progress) {
+        if (s->nodes >= s->progress_at) {
+            s->progress_at = s->nodes + s->every;
+            s->progress(search_done(s), s->nodes);
+        }
+        s->tick_at = s->progress_at;
+    }
+    if (s->ckpt) {
+        if (s->nodes >= s->ckpt_at) {
+            s->ckpt_at = s->nodes + s->ckpt->ckpt_every;
+            checkpoint(s->ckpt, s, RESUME_AT);
+        }
+        if (s->ckpt_at < s->tick_at) s->tick_at = s->ckpt_at;
+    }
+}
+
+// Whether checkpoints of the search s of p can be replayed: the column and
+// row orders must depend only on the rows being tried.
+static int search_replayable(dlx_t p, struct search_s *s) {
+    return !p->bound && !s->W && !s->dc && !s->ties && s->order != DLX_ORDER_RANDOM;
+}
+
+// Runs until the rows being tried form an exact cover, and returns 1, or
+// until the search is exhausted, and returns 0. A later call resumes where
+// the previous one left off.
+static int search_next(struct search_s *s) {
+    int found = s->B ? msearch_next(s) : s->dc ? dc_next(s) : s->bs ? bits_next(s) : links_next(s);
+    if (found) {
+        s->found++;
+        if (s->st) {
+            s->st->solutions++;
+            s->st->solutions_at[s->depth0 + s->n]++;
+        }
+    } else if (s->ckpt) {
+        checkpoint(s->ckpt, s, RESUME_DONE);
+        s->ckpt = 0;
+    }
+    return found;
+}
+
+// Abandons the search, restoring the links. A search that writes
+// checkpoints records that it got past the solution it stopped at.
+static void search_unwind(struct search_s *s) {
+    cell_ptr a = s->a;
+    if (s->ckpt && s->resume) checkpoint(s->ckpt, s, RESUME_PAST);
+    while (s->n) {
+        struct level_s *l = s->lev + --s->n;
+        if (s->dc) {
+            if (s->undo_cb) s->undo_cb();
+            dc_undo(s->dc, l->tcol);
+        } else if (s->bs) {
+            if (s->undo_cb) s->undo_cb();
+        } else if (!s->B) {
+            if (s->undo_cb) s->undo_cb();
+            unpick(a, s->S, l->r);  // The row's own column is l->c.
+        } else if (l->r != l->c) {
+            if (s->undo_cb) s->undo_cb();
+            muncommit_row(a, s->S, s->B, l->r);
+            mrestore(s, l);
+        } else {
+            LR_restore(a, l->c);
+            mrestore(s, l);
+        }
+    }
+}
+
+// Starts keeping p's statistics of the serial search s, reporting its
+// progress and writing checkpoints, if p asks for them, and resumes it from
+// the checkpoint dlx_resume() read, if any.
+static void search_watch(dlx_t p, struct search_s *s) {
+    if (p->progress && p->progress_every > 0 && !p->bound) {
+        s->progress = p->progress;
+        s->every = s->progress_at = p->progress_every;
+        s->tick = watch_tick;
+    }
+    if (p->ckpt && search_replayable(p, s)) {
+        s->ckpt = p;
+        s->ckpt_at = p->ckpt_every;
+        s->tick = watch_tick;
+    }
+    s->tick_at = s->tick ? 0 : LLONG_MAX;
+    if (p->replay && search_replayable(p, s)) {
+        s->found0 = p->replay_found;
+        s->nodes0 = p->replay_nodes;
+        if (!search_replay(s, p->replay, p->replayn)) {
+            // dlx_resume() checked the rows, so the instance has changed.
+            search_unwind(s);
+            s->ckpt = 0;
+            s->resume = 1;
+        }
+        s->resume |= p->replay_state != RESUME_AT;
+    }
+    free(p->replay);
+    p->replay = 0;
+    if (!p->stats_on) return;
+    stats_clear(&p->stats, max_depth(p) + 1);
+    stats_start(s, &p->stats);
+}
+
+// Dives from the root of the search to a leaf, choosing columns as the
+// search would and rows at random, and adds Knuth's estimates of the size of
+// the tree to *est: every node on the path stands for as many as the product
+// of the numbers of choices above it.
+static void probe(struct search_s *s, uint64_t *rng, struct dlx_estimate_s *est) {
+    cell_ptr a = s->a;
+    double w = 1;
+    for (;;) {
+        est->nodes += w;
+        if (s->symn && !sym_ok(s, a[root].R == root)) break;
+        if (a[root].R == root) {
+            est->solutions += w;
+            break;
+        }
+        int col = search_col(s);
+        int size = s->S[col];
+        link_t c = s->ctab[col];
+        if (!size) {
+            if (s->W) s->W[col]++;
+            break;
+        }
+        cover_col(a, s->S, c);
+        struct level_s *l = s->lev + s->n++;
+        *l = (struct level_s) { .c = c, .s = size, .r = a[c].D };
+        for (int k = rng_next(rng) % size; k; k--) l->r = a[l->r].D;
+        search_try(s, l);
+        w *= size;
+    }
+    search_unwind(s);
+}
+
+int dlx_estimate(dlx_t p, int samples, uint64_t seed, struct dlx_estimate_s *est) {
+    *est = (struct dlx_estimate_s) { 0 };
+    if (p->bound) return -1;
+    layout(p);
+    struct search_s s;
+    search_init(&s, p, p->cell, p->S);
+    F(i, samples) probe(&s, &seed, est);
+    search_free(&s);
+    if (samples > 0) {
+        est->nodes /= samples;
+        est->solutions /= samples;
+    }
+    return 0;
+}
+
+// Copies the rows dlx_reduce() forced, then those of the current solution,
+// into sol, which must hold max_depth(p) + p->forcedn rows.
+static int solution_rows(dlx_t p, struct search_s *s, int *sol) {
+    F(i, p->forcedn) sol[i] = p->forced[i];
+    return p->forcedn + search_rows(s, sol + p->forcedn);
+}
+
+int dlx_solve_max(dlx_t p, int max_solutions,
+                  void (*try_cb)(int, int, int),
+                  void (*undo_cb)(void),
+                  int (*found_cb)(),
+                  void (*stuck_cb)()) {
+    layout(p);
+    struct search_s s;
+    search_init(&s, p, p->cell, p->S);
+    search_engine(&s, p);
+    search_watch(p, &s);
+    s.try_cb = try_cb, s.undo_cb = undo_cb, s.stuck_cb = stuck_cb;
+    int count = 0;
+    while (search_next(&s)) {
+        count++;
+        if ((found_cb && found_cb()) || count == max_solutions) {
+            search_unwind(&s);
+            break;
+        }
+    }
+    search_free(&s);
+    return count;
+}
+
+void dlx_solve(dlx_t p,
+               void (*try_cb)(int, int, int),
+               void (*undo_cb)(void),
+               void (*found_cb)(),
+               void (*stuck_cb)()) {
+    layout(p);
+    struct search_s s;
+    search_init(&s, p, p->cell, p->S);
+    search_engine(&s, p);
+    search_watch(p, &s);
+    s.try_cb = try_cb, s.undo_cb = undo_cb, s.stuck_cb = stuck_cb;
+    while (search_next(&s)) if (found_cb) found_cb();
+    search_free(&s);
+}
+
+// Ends a randomized run: cuts every level, including those the search goes on
+// to make until it has backed out.
+static void run_out(struct search_s *s) {
+    s->out = 1;
+    s->tick_at = s->nodes + 1;
+    F(i, s->n) s->lev[i].cut = 1;
+}
+
+// The Luby sequence 1 1 2 1 1 2 4 1 1 2 1 1 2 4 8 ..., for i >= 1.
+static long long luby(long long i) {
+    for (;;) {
+        int k = 1;
+        while ((1LL << k) - 1 < i) k++;
+        if (i == (1LL << k) - 1) return 1LL << (k - 1);
+        i -= (1LL << (k - 1)) - 1;
+    }
+}
+
+int dlx_solve_random(dlx_t p, uint64_t seed, long long unit, long long budget,
+                     void (*cb)(int[], int)) {
+    layout(p);
+    int *sol = malloc(sizeof(int) * (max_depth(p) + p->forcedn + 1)), found = -1;
+    long long used = 0;
+    // The runs add up to one set of statistics.
+    if (p->stats_on) stats_clear(&p->stats, max_depth(p) + 1);
+    for (long long run = 1; found < 0 && (budget <= 0 || used < budget); run++) {
+        struct search_s s;
+        search_init(&s, p, p->cell, p->S);
+        if (p->stats_on) stats_start(&s, &p->stats);
+        if (!s.B) {
+            // Every run gets its own seed from the stream.
+            if (!s.cand) search_order_init(&s, p, DLX_ORDER_RANDOM, 0);
+            s.order = DLX_ORDER_RANDOM;
+            s.rng = rng_next(&seed);
+            s.ties = 1;
+            long long limit = unit > 0 ? unit * luby(run) : LLONG_MAX;
+            if (budget > 0 && limit > budget - used) limit = budget - used;
+            s.tick_at = limit;
+            s.tick = run_out;
+        }
+        if (search_next(&s)) {
+            int n = solution_rows(p, &s, sol);
+            if (cb) cb(sol, n);
+            search_unwind(&s);
+            found = 1;
+        } else if (!s.out) {
+            found = 0;
+        }
+        used += s.nodes;
+        search_free(&s);
+    }
+    free(sol);
+    return found;
+}
+
+// Writes job i of n, made of the k given rows, to the file named by prefix
+// followed by i. Returns 0 on success.
+static int job_put(dlx_t p, const char *prefix, int i, int n, const int *rows, int k) {
+    char path[strlen(prefix) + 16];
+    sprintf(path, "%s%d", prefix, i);
+    FILE *fp = fopen(path, "w");
+    if (!fp) return -1;
+    fprintf(fp, "# dlx job %d of %d: %d rows, %d columns\n", i, n, p->rtabn, p->ctabn);
+    F(j, k) fprintf(fp, "%s%d", j ? " " : "", rows[j]);
+    fputc('\n', fp);
+    return fclose(fp) ? -1 : 0;
+}
+
+// Counts the nodes at the given depth and the exact covers above it, and
+// sets *deeper if the search goes on below. Unless prefix is NULL, writes
+// each of them as a job, out of n. Returns the count, or -1 on failure.
+static int split_walk(dlx_t p, int depth, int *deeper, const char *prefix, int n) {
+    struct search_s s;
+    search_init(&s, p, p->cell, p->S);
+    s.cap = depth;
+    int *sol = malloc(sizeof(int) * (depth + 1)), count = 0, err = 0;
+    *deeper = 0;
+    while (!err && search_next(&s)) {
+        if (s.a[root].R != root) *deeper = 1;
+        if (prefix) err = job_put(p, prefix, count, n, sol, search_rows(&s, sol));
+        count++;
+    }
+    if (err) search_unwind(&s);
+    free(sol);
+    search_free(&s);
+    return err ? -1 : count;
+}
+
+int dlx_split(dlx_t p, int depth, int count, const char *prefix) {
+    if (p->bound) return -1;
+    layout(p);
+    int n, deeper;
+    if (depth > 0) {
+        n = split_walk(p, depth, &deeper, 0, 0);
+    } else {
+        // The shallowest cut with enough jobs, or the deepest there is.
+        depth = 1;
+        while ((n = split_walk(p, depth, &deeper, 0, 0)) < count && deeper) depth++;
+    }
+    return split_walk(p, depth, &deeper, prefix, n);
+}
+
+int dlx_pick_job(dlx_t p, const char *path) {
+    FILE *fp = fopen(path, "r");
+    if (!fp) return -1;
+    int rows, cols, n = 0, x, *job = malloc(sizeof(int) * (p->ctabn + 1));
+    int ok = !p->bound && fscanf(fp, "# dlx job %*d of %*d: %d rows, %d columns", &rows, &cols) == 2 &&
+             rows == p->rtabn && cols == p->ctabn;
+    // A job never has more rows than there are columns.
+    while (ok && fscanf(fp, "%d", &x) == 1) {
+        if (x < 0 || x >= p->rtabn || n == p->ctabn) ok = 0; else job[n++] = x;
+    }
+    ok = ok && feof(fp);
+    fclose(fp);
+    layout(p);
+    cell_ptr a = p->cell;
+    // The order of the rows for lex-leader pruning depends on which are
+    // live, so a job keeps the one the split saw.
+    struct search_s s = { .ord = 0 };
+    if (ok && p->symn && !p->sym_ord) search_init(&s, p, a, p->S);
+    int k = 0;
+    for (; ok && k < n && p->rtab[job[k]] && row_live(p, p->rtab[job[k]]); k++) {
+        select_row(a, p->S, p->rtab[job[k]]);
+    }
+    if (ok && k == n) {
+        // The rows go in every solution, like those dlx_reduce() forces.
+        p->forced = realloc(p->forced, sizeof(int) * (p->forcedn + n));
+        F(i, n) {
+            p->forced[p->forcedn++] = job[i];
+            undo_log(p, UNDO_FORCE, job[i], p->rtab[job[i]]);
+        }
+        if (s.ord) {
+            p->sym_ord = s.ord;
+            p->sym_ordn = s.ordn;
+            p->sym_col = s.sym_col;
+            s.ord = 0;
+            undo_log(p, UNDO_SYM, -1, 0);
+        }
+    } else {
+        while (k--) unselect_row(a, p->S, p->rtab[job[k]]);
+        ok = 0;
+    }
+    if (s.lev) search_free(&s);
+    free(job);
+    return ok ? 0 : -1;
+}
+
+long long dlx_resume(dlx_t p, const char *path) {
+    FILE *fp = fopen(path, "r");
+    if (!fp) return -1;
+    int rows, cols, n, k = 0, x, state = 0, *at = malloc(sizeof(int) * (p->ctabn + 1));
+    long long found, nodes;
+    char word[8];
+    int ok = fscanf(fp, "# dlx checkpoint: %d rows, %d columns %lld solutions, %lld nodes %7s %d:",
+                    &rows, &cols, &found, &nodes, word, &n) == 6 &&
+             rows == p->rtabn && cols == p->ctabn && n >= 0 && n <= p->ctabn;
+    while (ok && state < 3 && strcmp(word, resume_state[state])) state++;
+    ok = ok && state < 3;
+    while (ok && k < n && fscanf(fp, "%d", at + k) == 1) k++;
+    ok = ok && k == n && fscanf(fp, "%d", &x) == EOF;
+    fclose(fp);
+    // Check the rows lead somewhere, as they would have if the instance and
+    // settings are those of the search that wrote the checkpoint.
+    if (ok) {
+        layout(p);
+        struct search_s s;
+        search_init(&s, p, p->cell, p->S);
+        ok = search_replayable(p, &s) && search_replay(&s, at, n);
+        search_unwind(&s);
+        search_free(&s);
+    }
+    if (!ok) {
+        free(at);
+        return -1;
+    }
+    free(p->replay);
+    p->replay = at;
+    p->replayn = n;
+    p->replay_state = state;
+    p->replay_found = found;
+    p->replay_nodes = nodes;
+    return found;
+}
+
+// Calls whichever of cb or void_cb is given on every exact cover.
+static int forall(dlx_t p, int max_solutions,
+                  int (*cb)(int[], int), void (*void_cb)(int[], int)) {
+    layout(p);
+    struct search_s s;
+    search_init(&s, p, p->cell, p->S);
+    search_engine(&s, p);
+    search_watch(p, &s);
+    int *sol = malloc(sizeof(int) * (max_depth(p) + p->forcedn + 1)), count = 0;
+    while (search_next(&s)) {
+        int n = solution_rows(p, &s, sol);
+        count++;
+        if (void_cb) {
+            void_cb(sol, n);
+        } else if ((cb && cb(sol, n)) || count == max_solutions) {
+            search_unwind(&s);
+            break;
+        }
+    }
+    free(sol);
+    search_free(&s);
+    return count;
+}
+
+int dlx_forall_cover_max(dlx_t p, int max_solutions, int (*cb)(int[], int)) {
+    return forall(p, max_solutions, cb, 0);
+}
+
+void dlx_forall_cover(dlx_t p, void (*cb)(int[], int)) {
+    forall(p, 0, 0, cb);
+}
+
+// Appends a solution of n rows to the batch. Returns 0 if there is no room.
+static int batch_push(struct dlx_batch_s *b, const int *rows, int n) {
+    if (b->n == b->cap || b->off[b->n] + n > b->rows_cap) return 0;
+    memcpy(b->rows + b->off[b->n], rows, sizeof(int) * n);
+    b->off[b->n + 1] = b->off[b->n] + n;
+    b->n++;
+    return 1;
+}
+
+// Whether to hand over the batch now, the last solution having had n rows:
+// it is full, or likely has no room for another like it.
+static int batch_full(const struct dlx_batch_s *b, int n) {
+    return b->n == b->cap || b->off[b->n] + n > b->rows_cap;
+}
+
+// Hands over the batch and empties it, adding its solutions to *count.
+// Returns nonzero if cb asks to stop.
+static int batch_hand(struct dlx_batch_s *b, long *count, int (*cb)(struct dlx_batch_s *)) {
+    *count += b->n;
+    int stop = cb(b);
+    b->n = 0;
+    return stop;
+}
+
+long dlx_forall_cover_batch(dlx_t p, struct dlx_batch_s *b, int (*cb)(struct dlx_batch_s *)) {
+    if (b->cap < 1) return -1;
+    layout(p);
+    struct search_s s;
+    search_init(&s, p, p->cell, p->S);
+    search_engine(&s, p);
+    search_watch(p, &s);
+    // Checkpoints wait for the batch to be handed over, so they never count
+    // solutions the caller has yet to see.
+    dlx_t ck = s.ckpt;
+    long long ck_at = ck ? ck->ckpt_every : 0;
+    s.ckpt = 0;
+    int *sol = malloc(sizeof(int) * (max_depth(p) + p->forcedn + 1)), stop = 0;
+    long count = 0;
+    b->n = 0;
+    b->off[0] = 0;
+    while (!stop && search_next(&s)) {
+        int n = solution_rows(p, &s, sol);
+        if (n > b->rows_cap) {
+            stop = -1;
+        } else if (!batch_push(b, sol, n)) {
+            // Longer than the solutions before it: they go first.
+            if ((stop = batch_hand(b, &count, cb))) {
+                // The caller never saw this solution: resuming finds it again.
+                s.found--;
+                if (ck) checkpoint(ck, &s, RESUME_AT);
+            } else {
+                batch_push(b, sol, n);
+            }
+        }
+        if (!stop && batch_full(b, n)) {
+            stop = batch_hand(b, &count, cb);
+            if (ck && (stop || s.nodes >= ck_at)) {
+                checkpoint(ck, &s, RESUME_PAST);
+                ck_at = s.nodes + ck->ckpt_every;
+            }
+        }
+    }
+    if (stop) {
+        search_unwind(&s);
+    } else {
+        if (b->n) batch_hand(b, &count, cb);
+        if (ck) checkpoint(ck, &s, RESUME_DONE);
+    }
+    free(sol);
+    search_free(&s);
+    return stop < 0 ? -1 : count;
+}
+
+struct dlx_iter_s {
+    dlx_t p;
+    struct search_s s;
+    int *sol, done;
+};
+
+dlx_iter_t dlx_iter_new(dlx_t p) {
+    layout(p);
+    dlx_iter_t it = malloc(sizeof(*it));
+    it->p = p;
+    search_init(&it->s, p, p->cell, p->S);
+    search_engine(&it->s, p);
+    search_watch(p, &it->s);
+    it->sol = malloc(sizeof(int) * (max_depth(p) + p->forcedn + 1));
+    it->done = 0;
+    return it;
+}
+
+int dlx_iter_next(dlx_iter_t it, int **rows, int *n) {
+    if (it->done || !search_next(&it->s)) {
+        it->done = 1;
+        return 0;
+    }
+    *n = solution_rows(it->p, &it->s, it->sol);
+    *rows = it->sol;
+    return 1;
+}
+
+void dlx_iter_free(dlx_iter_t it) {
+    search_unwind(&it->s);
+    search_free(&it->s);
+    free(it->sol);
+    free(it);
+}
+
+// Parallel search. Workers take jobs from a shared pool, where a job is a
+// list of rows to pick before searching. A busy worker that notices an idle
+// one hands over the untried rows at its shallowest unfinished level.
+struct pool_s {
+    dlx_t p;
+    int nthreads, idle, done, stop;
+    int **job, jobn, job_alloc;  // job[i][0] is the number of rows that follow.
+    pthread_mutex_t lock, cb_lock;
+    pthread_cond_t cond;
+    int (*cb)(int[], int);
+    // For batched delivery, the callback and the size of each worker's batch,
+    // and whether some solution did not fit.
+    int (*batch_cb)(struct dlx_batch_s *);
+    int cap, rows_cap, err;
+};
+
+struct worker_s {
+    struct search_s s;  // First, so the tick callback can find the worker.
+    struct pool_s *q;
+    int *sol, base;  // The job's rows, followed by the rows being tried.
+    long count;
+    struct dlx_stats_s *st;  // The worker's own statistics, if kept.
+    struct dlx_batch_s batch;  // Solutions not yet handed over, if batching.
+    pthread_t thread;
+};
+
+// How many nodes a worker visits between looks at the pool.
+enum { POLL_NODES = 64 };
+
+// Stops the search: busy workers cut their levels at their next look at the
+// pool, and idle ones wake up to leave.
+static void pool_stop(struct pool_s *q) {
+    pthread_mutex_lock(&q->lock);
+    __atomic_store_n(&q->stop, 1, __ATOMIC_RELAXED);
+    q->done = 1;
+    pthread_cond_broadcast(&q->cond);
+    pthread_mutex_unlock(&q->lock);
+}
+
+static void pool_push(struct pool_s *q, int *rows, int n) {
+    int *job = malloc(sizeof(int) * (n + 1));
+    job[0] = n;
+    memcpy(job + 1, rows, sizeof(int) * n);
+    if (q->jobn == q->job_alloc) {
+        q->job = realloc(q->job, sizeof(int *) * (q->job_alloc *= 2));
+    }
+    q->job[q->jobn++] = job;
+}
+
+// Hands over the remaining rows of the shallowest level that has some, if a
+// worker is idle and there is nothing in the pool for it.
+static void par_tick(struct search_s *s) {
+    struct worker_s *w = (struct worker_s *) s;
+    struct pool_s *q = w->q;
+    s->tick_at = s->nodes + POLL_NODES;
+    if (__atomic_load_n(&q->stop, __ATOMIC_RELAXED)) {
+        F(i, s->n) s->lev[i].cut = 1;
+        return;
+    }
+    if (!__atomic_load_n(&q->idle, __ATOMIC_RELAXED) ||
+            __atomic_load_n(&q->jobn, __ATOMIC_RELAXED)) return;
+    cell_ptr a = s->a;
+    F(i, s->n) {
+        struct level_s *l = s->lev + i, t = *l;
+        if (l->cut || search_step(s, &t) == l->c) continue;
+        search_rows(s, w->sol + w->base);
+        pthread_mutex_lock(&q->lock);
+        for (; t.r != l->c; search_step(s, &t)) {
+            w->sol[w->base + i] = a[t.r].n;
+            pool_push(q, w->sol, w->base + i + 1);
+        }
+        pthread_cond_broadcast(&q->cond);
+        pthread_mutex_unlock(&q->lock);
+        l->cut = 1;
+        return;
+    }
+}
+
+// Hands over the worker's batch, unless the search has been stopped, taking
+// the lock once for all its solutions.
+static void par_hand(struct worker_s *w) {
+    struct pool_s *q = w->q;
+    pthread_mutex_lock(&q->cb_lock);
+    if (!q->stop && batch_hand(&w->batch, &w->count, q->batch_cb)) pool_stop(q);
+    w->batch.n = 0;
+    pthread_mutex_unlock(&q->cb_lock);
+}
+
+static void *par_worker(void *arg) {
+    struct worker_s *w = arg;
+    struct pool_s *q = w->q;
+    cell_ptr a = w->s.a;
+    if (w->st) stats_start(&w->s, w->st);
+    for (;;) {
+        pthread_mutex_lock(&q->lock);
+        q->idle++;
+        while (!q->jobn && !q->done) {
+            if (q->idle == q->nthreads) {
+                q->done = 1;
+                pthread_cond_broadcast(&q->cond);
+                break;
+            }
+            pthread_cond_wait(&q->cond, &q->lock);
+        }
+        if (q->done) {
+            pthread_mutex_unlock(&q->lock);
+            if (w->st) stats_stop(&w->s);
+            if (w->batch.n) par_hand(w);
+            return 0;
+        }
+        q->idle--;
+        int *job = q->job[--q->jobn];
+        pthread_mutex_unlock(&q->lock);
+
+        w->base = job[0];
+        memcpy(w->sol, job + 1, sizeof(int) * w->base);
+        F(i, w->base) select_row(a, w->s.S, q->p->rtab[w->sol[i]]);
+        w->s.pre = w->sol;
+        w->s.pren = w->base;
+        w->s.resume = 0;
+        w->s.depth0 = w->base;
+        w->s.tick_at = w->s.nodes + POLL_NODES;
+        while (search_next(&w->s)) {
+            if (!q->cb && !q->batch_cb) {
+                w->count++;
+                continue;
+            }
+            int n = w->base + solution_rows(q->p, &w->s, w->sol + w->base);
+            if (q->batch_cb) {
+                if (n > q->rows_cap) {
+                    q->err = 1;
+                    pool_stop(q);
+                } else if (!batch_push(&w->batch, w->sol, n)) {
+                    par_hand(w);
+                    batch_push(&w->batch, w->sol, n);
+                }
+                if (batch_full(&w->batch, n)) par_hand(w);
+                if (!__atomic_load_n(&q->stop, __ATOMIC_RELAXED)) continue;
+                search_unwind(&w->s);
+                break;
+            }
+            pthread_mutex_lock(&q->cb_lock);
+            if (!q->stop) {
+                w->count++;
+                if (q->cb(w->sol, n)) pool_stop(q);
+            }
+            pthread_mutex_unlock(&q->cb_lock);
+            if (__atomic_load_n(&q->stop, __ATOMIC_RELAXED)) {
+                search_unwind(&w->s);
+                break;
+            }
+        }
+        for (int i = w->base - 1; i >= 0; i--) {
+            unselect_row(a, w->s.S, q->p->rtab[w->sol[i]]);
+        }
+        free(job);
+    }
+}
+
+// Searches in parallel, delivering solutions one at a time to cb or, if
+// batch_cb is given, in batches of the given sizes.
+static long parallel(dlx_t p, int nthreads, int (*cb)(int[], int),
+                     int (*batch_cb)(struct dlx_batch_s *), int cap, int rows_cap) {
+    if (nthreads <= 0) nthreads = sysconf(_SC_NPROCESSORS_ONLN);
+    if (nthreads <= 0) nthreads = 1;
+    layout(p);
+    double t0 = now();
+    if (p->stats_on) stats_clear(&p->stats, max_depth(p) + 1);
+    struct pool_s q = {
+        .p = p, .nthreads = nthreads, .cb = cb,
+        .batch_cb = batch_cb, .cap = cap, .rows_cap = rows_cap,
+        .job_alloc = 8, .job = malloc(sizeof(int *) * 8),
+    };
+    pthread_mutex_init(&q.lock, 0);
+    pthread_mutex_init(&q.cb_lock, 0);
+    pthread_cond_init(&q.cond, 0);
+    pool_push(&q, 0, 0);
+    struct worker_s w[nthreads];
+    F(i, nthreads) {
+        cell_ptr a = malloc(sizeof(*a) * p->celln);
+        memcpy(a, p->cell, sizeof(*a) * p->celln);
+        int *S = malloc(sizeof(int) * p->ctabn);
+        memcpy(S, p->S, sizeof(int) * p->ctabn);
+        search_init(&w[i].s, p, a, S);
+        w[i].s.tick = par_tick;
+        w[i].q = &q;
+        // A job's rows and those tried below it never outnumber the columns.
+        w[i].sol = malloc(sizeof(int) * (p->ctabn + p->forcedn + 1));
+        w[i].count = 0;
+        w[i].st = 0;
+        w[i].batch = (struct dlx_batch_s) { .cap = cap, .rows_cap = rows_cap };
+        if (batch_cb) {
+            w[i].batch.off = calloc(cap + 1, sizeof(int));
+            w[i].batch.rows = malloc(sizeof(int) * rows_cap);
+        }
+        if (p->stats_on) stats_clear(w[i].st = calloc(1, sizeof(*w[i].st)), max_depth(p) + 1);
+        pthread_create(&w[i].thread, 0, par_worker, w + i);
+    }
+    long count = 0;
+    F(i, nthreads) {
+        pthread_join(w[i].thread, 0);
+        count += w[i].count;
+        if (w[i].st) {
+            stats_add(&p->stats, w[i].st);
+            stats_free(w[i].st);
+            free(w[i].st);
+        }
+        free(w[i].s.a);
+        free(w[i].s.S);
+        search_free(&w[i].s);
+        free(w[i].sol);
+        free(w[i].batch.off);
+        free(w[i].batch.rows);
+    }
+    F(i, q.jobn) free(q.job[i]);
+    free(q.job);
+    pthread_cond_destroy(&q.cond);
+    pthread_mutex_destroy(&q.cb_lock);
+    pthread_mutex_destroy(&q.lock);
+    if (p->stats_on) p->stats.seconds = now() - t0;
+    return q.err ? -1 : count;
+}
+
+long dlx_forall_cover_parallel(dlx_t p, int nthreads, int (*cb)(int[], int)) {
+    if (p->bound) return forall(p, 0, cb, 0);
+    return parallel(p, nthreads, cb, 0, 0, 0);
+}
+
+long dlx_forall_cover_parallel_batch(dlx_t p, int nthreads, int cap, int rows_cap,
+                                     int (*cb)(struct dlx_batch_s *)) {
+    if (cap < 1) return -1;
+    if (!p->bound) return parallel(p, nthreads, 0, cb, cap, rows_cap);
+    struct dlx_batch_s b = {
+        .off = malloc(sizeof(int) * (cap + 1)), .rows = malloc(sizeof(int) * rows_cap),
+        .cap = cap, .rows_cap = rows_cap,
+    };
+    long count = dlx_forall_cover_batch(p, &b, cb);
+    free(b.off);
+    free(b.rows);
+    return count;
+}
+
+// Dancing links with ZDDs (Knuth's Algorithm DXZ). The subproblem below a
+// node depends only on which columns have been covered since the search
+// began, so results are memoized on that set. Each result is a ZDD node:
+// taking its hi branch picks its row, taking its lo branch rejects it.
+enum { ZDD_BOT, ZDD_TOP };
+
+struct dlx_zdd_s {
+    int n, alloc;
+    int *row;
+    uint32_t *lo, *hi;
+    dlx_count_t *count;
+    int *len;      // Rows in the largest solution below each node.
+    uint32_t top;  // The node for the whole instance.
+};
+
+static uint32_t zdd_node(dlx_zdd_t z, int row, uint32_t lo, uint32_t hi) {
+    if (z->n == z->alloc) {
+        z->alloc *= 2;
+        z->row = realloc(z->row, sizeof(*z->row) * z->alloc);
+        z->lo = realloc(z->lo, sizeof(*z->lo) * z->alloc);
+        z->hi = realloc(z->hi, sizeof(*z->hi) * z->alloc);
+        z->count = realloc(z->count, sizeof(*z->count) * z->alloc);
+        z->len = realloc(z->len, sizeof(*z->len) * z->alloc);
+    }
+    z->row[z->n] = row;
+    z->lo[z->n] = lo;
+    z->hi[z->n] = hi;
+    z->count[z->n] = z->count[lo] + z->count[hi];
+    z->len[z->n] = z->len[lo] > 1 + z->len[hi] ? z->len[lo] : 1 + z->len[hi];
+    return z->n++;
+}
+
+// Open-addressed hash table from sets of covered columns to ZDD nodes.
+struct memo_s {
+    int words, n, cap;
+    uint64_t *key;
+    uint32_t *val, *slot;  // slot[i] is 1 + an entry index, or 0 if free.
+};
+
+static uint64_t memo_hash(uint64_t *key, int words) {
+    uint64_t h = 0x9e3779b97f4a7c15ull;
+    F(i, words) h = (h ^ key[i]) * 0xff51afd7ed558ccdull, h ^= h >> 32;
+    return h;
+}
+
+static uint32_t *memo_find(struct memo_s *m, uint64_t *key) {
+    for (uint64_t i = memo_hash(key, m->words);; i++) {
+        uint32_t *slot = m->slot + (i & (m->cap - 1));
+        if (!*slot || !memcmp(m->key + (uint64_t)(*slot - 1) * m->words,
+                key, sizeof(uint64_t) * m->words)) {
+            return slot;
+        }
+    }
+}
+
+static void memo_put(struct memo_s *m, uint64_t *key, uint32_t val) {
+    if (2 * (m->n + 1) > m->cap) {
+        uint32_t *old = m->slot;
+        m->slot = calloc(m->cap *= 2, sizeof(*m->slot));
+        F(i, m->cap / 2) if (old[i]) {
+            *memo_find(m, m->key + (uint64_t)(old[i] - 1) * m->words) = old[i];
+        }
+        free(old);
+        m->key = realloc(m->key, sizeof(uint64_t) * m->words * m->cap / 2);
+        m->val = realloc(m->val, sizeof(uint32_t) * m->cap / 2);
+    }
+    memcpy(m->key + (uint64_t)m->n * m->words, key, sizeof(uint64_t) * m->words);
+    m->val[m->n] = val;
+    *memo_find(m, key) = ++m->n;
+}
+
+// Covers the column with header c, noting it in the key.
+static void zdd_cover(cell_ptr a, int *S, uint64_t *key, link_t c) {
+    key[a[c].n / 64] |= 1ull << a[c].n % 64;
+    cover_col(a, S, c);
+}
+
+static void zdd_uncover(cell_ptr a, int *S, uint64_t *key, link_t c) {
+    uncover_col(a, S, c);
+    key[a[c].n / 64] &= ~(1ull << a[c].n % 64);
+}
+
+// Like commit(), noting the color of a purified column in the key, after the
+// bits for the covered columns, since it decides which rows remain too.
+static void zdd_commit(cell_ptr a, int *S, uint64_t *key, int colors, link_t j) {
+    if (!a[j].color) {
+        zdd_cover(a, S, key, a[j].c);
+    } else if (a[j].color > 0) {
+        ((uint32_t *)(key + colors))[a[a[j].c].n] = a[j].color;
+        purify(a, S, j);
+    }
+}
+
+static void zdd_uncommit(cell_ptr a, int *S, uint64_t *key, int colors, link_t j) {
+    if (!a[j].color) {
+        zdd_uncover(a, S, key, a[j].c);
+    } else if (a[j].color > 0) {
+        unpurify(a, S, j);
+        ((uint32_t *)(key + colors))[a[a[j].c].n] = 0;
+    }
+}
+
+dlx_zdd_t dlx_zdd_new(dlx_t p) {
+    if (p->bound) return 0;
+    layout(p);
+    cell_ptr a = p->cell;
+    int *S = p->S;
+    dlx_zdd_t z = malloc(sizeof(*z));
+    z->alloc = 64;
+    z->row = malloc(sizeof(*z->row) * z->alloc);
+    z->lo = malloc(sizeof(*z->lo) * z->alloc);
+    z->hi = malloc(sizeof(*z->hi) * z->alloc);
+    z->count = malloc(sizeof(*z->count) * z->alloc);
+    z->len = malloc(sizeof(*z->len) * z->alloc);
+    // The two sinks: no solution, and the empty solution.
+    z->row[ZDD_BOT] = z->row[ZDD_TOP] = -1;
+    z->lo[ZDD_BOT] = z->hi[ZDD_BOT] = z->lo[ZDD_TOP] = z->hi[ZDD_TOP] = ZDD_BOT;
+    z->count[ZDD_BOT] = 0;
+    z->count[ZDD_TOP] = 1;
+    z->len[ZDD_BOT] = z->len[ZDD_TOP] = 0;
+    z->n = 2;
+
+    // The key holds a bit per column, then a color per column if need be.
+    int bits = (p->ctabn + 64) / 64;
+    struct memo_s m = {
+        .words = bits + (p->colors ? (p->ctabn + 1) / 2 : 0), .cap = 64,
+    };
+    m.key = malloc(sizeof(uint64_t) * m.words * m.cap / 2);
+    m.val = malloc(sizeof(uint32_t) * m.cap / 2);
+    m.slot = calloc(m.cap, sizeof(*m.slot));
+    uint64_t *key = calloc(m.words, sizeof(uint64_t));
+
+    // The stack of levels, plus a stack of (row, result) pairs for the rows
+    // of each level that have been finished.
+    struct level_s *lev = malloc(sizeof(*lev) * (p->ctabn + 1));
+    int *done_row = malloc(sizeof(int) * p->rtabn);
+    uint32_t *done_z = malloc(sizeof(uint32_t) * p->rtabn);
+    int n = 0, donen = 0;
+    uint32_t res;
+    for (;;) {
+        // Enter a node.
+        link_t c = a[root].R;
+        uint32_t *slot;
+        if (c == root) {
+            res = ZDD_TOP;
+        } else if (*(slot = memo_find(&m, key))) {
+            res = m.val[*slot - 1];
+        } else {
+            int col = min_col(S, p->ctabn);
+            c = p->ctab[col];
+            if (S[col]) {
+                zdd_cover(a, S, key, c);
+                // Reuse 's' to remember where this level's pairs begin.
+                lev[n] = (struct level_s) { .c = c, .r = a[c].D, .s = donen };
+                C(j, lev[n].r, R) zdd_commit(a, S, key, bits, j);
+                n++;
+                continue;
+            }
+            res = ZDD_BOT;
+            memo_put(&m, key, res);
+        }
+        // Return res to the level above, moving on to its next row or
+        // finishing it, for as many levels as finish.
+        for (;;) {
+            if (!n) goto finish;
+            struct level_s *l = lev + n - 1;
+            C(j, l->r, L) zdd_uncommit(a, S, key, bits, j);
+            if (res != ZDD_BOT) {
+                done_row[donen] = a[l->r].n;
+                done_z[donen++] = res;
+            }
+            l->r = a[l->r].D;
+            if (l->r != l->c) {
+                C(j, l->r, R) zdd_commit(a, S, key, bits, j);
+                break;
+            }
+            // Chain the finished rows, keeping their top-to-bottom order.
+            res = ZDD_BOT;
+            while (donen > l->s) {
+                donen--;
+                res = zdd_node(z, done_row[donen], res, done_z[donen]);
+            }
+            zdd_uncover(a, S, key, l->c);
+            memo_put(&m, key, res);
+            n--;
+        }
+    }
+finish:
+    // Rows forced by dlx_reduce() go above the rest.
+    if (res != ZDD_BOT) {
+        for (int i = p->forcedn - 1; i >= 0; i--) res = zdd_node(z, p->forced[i], ZDD_BOT, res);
+    }
+    z->top = res;
+    free(done_z);
+    free(done_row);
+    free(lev);
+    free(key);
+    free(m.slot);
+    free(m.val);
+    free(m.key);
+    return z;
+}
+
+void dlx_zdd_free(dlx_zdd_t z) {
+    free(z->row);
+    free(z->lo);
+    free(z->hi);
+    free(z->count);
+    free(z->len);
+    free(z);
+}
+
+dlx_count_t dlx_zdd_count(dlx_zdd_t z) { return z->count[z->top]; }
+
+int dlx_zdd_size(dlx_zdd_t z) { return z->n; }
+
+int dlx_zdd_depth(dlx_zdd_t z) { return z->len[z->top]; }
+
+dlx_count_t dlx_zdd_forall(dlx_zdd_t z, int (*cb)(int rows[], int n)) {
+    // Depth-first over the ZDD, holding the nodes whose hi branch is being
+    // explored; their rows form the current partial solution.
+    int *rows = malloc(sizeof(int) * (z->len[z->top] + 1)), n = 0;
+    uint32_t *path = malloc(sizeof(uint32_t) * (z->len[z->top] + 1)), v = z->top;
+    dlx_count_t count = 0;
+    for (;;) {
+        // Descend along hi branches.
+        while (v > ZDD_TOP) {
+            path[n] = v;
+            rows[n++] = z->row[v];
+            v = z->hi[v];
+        }
+        if (v == ZDD_TOP) {
+            count++;
+            if (cb && cb(rows, n)) break;
+        }
+        // Backtrack to the deepest node whose lo branch is unexplored.
+        do {
+            if (!n) goto done;
+            v = z->lo[path[--n]];
+        } while (v == ZDD_BOT);
+    }
+done:
+    free(path);
+    free(rows);
+    return count;
+}
+
+int dlx_zdd_sample(dlx_zdd_t z, uint64_t *seed, int rows[]) {
+    dlx_count_t total = z->count[z->top], k;
+    if (!total) return -1;
+    // Draw k uniformly below total by rejection, then unrank it.
+    int bits = 0;
+    while (bits < 128 && (total - 1) >> bits) bits++;
+    do {
+        k = (dlx_count_t)rng_next(seed) << 64 | rng_next(seed);
+        if (bits < 128) k &= ((dlx_count_t)1 << bits) - 1;
+    } while (k >= total);
+    int n = 0;
+    for (uint32_t v = z->top; v != ZDD_TOP;) {
+        dlx_count_t hi = z->count[z->hi[v]];
+        if (k < hi) {
+            rows[n++] = z->row[v];
+            v = z->hi[v];
+        } else {
+            k -= hi;
+            v = z->lo[v];
+        }
+    }
+    return n;
+}
+
+dlx_count_t dlx_count(dlx_t p) {
+    if (p->bound) {
+        layout(p);
+        struct search_s s;
+        search_init(&s, p, p->cell, p->S);
+        dlx_count_t count = 0;
+        while (search_next(&s)) count++;
+        search_free(&s);
+        return count;
+    }
+    dlx_zdd_t z = dlx_zdd_new(p);
+    dlx_count_t count = dlx_zdd_count(z);
+    dlx_zdd_free(z);
+    return count;
+}
+
+char *dlx_count_str(dlx_count_t n, char buf[40]) {
+    char *s = buf + 39;
+    *s = 0;
+    do *--s = '0' + n % 10; while (n /= 10);
+    return memmove(buf, s, buf + 40 - s);
 }
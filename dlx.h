@@ -5,6 +5,9 @@
 //
 // Row and column numbers are 0-indexed.
 
+#include <stdint.h>
+#include <stdio.h>
+
 struct dlx_s;
 typedef struct dlx_s *dlx_t;
 
@@ -20,23 +23,231 @@ int dlx_rows(dlx_t dlx);
 // Returns number of columns.
 int dlx_cols(dlx_t dlx);
 
+// Rules for choosing the column to branch on.
+enum {
+    // The first column with the fewest rows (Knuth's S heuristic).
+    DLX_MRV,
+    // The first column with the fewest rows per unit of weight, where a
+    // column's weight starts at 1 and goes up each time the search gets stuck
+    // on it. Often visits fewer nodes on hard instances, but solutions may
+    // arrive in a different order.
+    DLX_WDEG,
+};
+
+// Sets the rule used by later searches. The default is DLX_MRV. Weights start
+// afresh with each search, and the memoized search always uses DLX_MRV.
+void dlx_set_strategy(dlx_t dlx, int strategy);
+
+// Orders in which to try the rows of the chosen column.
+enum {
+    // The order of the dlx_set() calls that made them.
+    DLX_ORDER_INSERTION,
+    // Rows whose other columns have the most rows between them first, as
+    // they leave the most choices open. Ties keep insertion order.
+    DLX_ORDER_LEAST_CONSTRAINING,
+    // A random order, the same for the same seed.
+    DLX_ORDER_RANDOM,
+};
+
+// Sets the row order used by later searches, and the seed for
+// DLX_ORDER_RANDOM. The default is DLX_ORDER_INSERTION. Any order finds the
+// same exact covers, but the first ones may come much sooner; the memoized
+// search always uses insertion order.
+void dlx_set_row_order(dlx_t dlx, int order, uint64_t seed);
+
+// Representations the search can dance on.
+enum {
+    // Doubly linked lists (Knuth's dancing links).
+    DLX_LINKS,
+    // Arrays holding each column's rows, those still in play first, so
+    // undoing a move just restores a length (Knuth's dancing cells). Built
+    // afresh for each search. Finds the same exact covers after the same
+    // number of nodes, but not necessarily in the same order.
+    DLX_CELLS,
+    // A bitset of columns per row, and at each level the list of rows still
+    // in play, filtered with a few ANDs per row. Built afresh for each
+    // search, for instances of at most 512 columns without colors. Finds the
+    // same exact covers in the same order after the same number of nodes.
+    DLX_BITS,
+    // DLX_BITS for instances of at most 128 columns, where it is usually
+    // the fastest, and DLX_LINKS otherwise.
+    DLX_AUTO,
+};
+
+// Sets the representation used by later searches. The default is DLX_AUTO,
+// or the one named by the environment variable DLX_BACKEND ("links", "cells"
+// or "bits") when the instance is made. Searches with bounds, with a row
+// order other than insertion, in parallel or memoized always dance on links,
+// and so do searches on bitsets that use DLX_WDEG or colors, or have columns
+// whose rows were not added in order.
+void dlx_set_backend(dlx_t dlx, int backend);
+
 // Places a 1 in the given row and column.
 // Increases the number of rows and columns if necessary.
 void dlx_set(dlx_t dlx, int row, int col);
 
+// Adds a row after the last one, with a 1 in each of the n given columns,
+// which may come in any order and repeat. Increases the number of columns if
+// necessary. Returns the new row's number. Takes time linear in n, whereas a
+// row built with dlx_set() calls takes time quadratic in its length.
+int dlx_add_row(dlx_t dlx, const int *cols, int n);
+
+// Makes room for the given numbers of rows, columns and 1s in all, so that
+// building an instance of that size allocates nothing more.
+void dlx_reserve(dlx_t dlx, int rows, int cols, int nnz);
+
 // Marks a column as optional: a solution need not cover the given column,
 // but it still must respect the constraints it entails.
 void dlx_mark_optional(dlx_t dlx, int col);
 
-// Removes a row from consideration. Returns 0 on success, -1 otherwise.
+// Requires the column to be covered at least lo and at most hi times, rather
+// than exactly once. Bounds of 0 and 1 make it optional; any other bounds
+// make it primary again if dlx_mark_optional(), dlx_set_color() or earlier
+// bounds made it optional, and its colors are then ignored: its colored 1s
+// count as plain ones. While any column has bounds other than 0 and 1 or 1
+// and 1, searches use Knuth's Algorithm M, which tries each set of rows for a
+// column once whatever the order they are chosen in, so k identical pieces
+// sharing a column with bounds k and k yield no duplicate solutions. That
+// search ignores dlx_set_strategy() and dlx_set_row_order(), does not run in
+// parallel, and has no memoized form: dlx_zdd_new() returns NULL and
+// dlx_count() enumerates.
+void dlx_set_bounds(dlx_t dlx, int col, int lo, int hi);
+
+// Places a 1 in the given row and column, giving it a color, which must be
+// positive, and marks the column as optional. Rows may share such a column,
+// provided they all give it the same color; a row with a plain 1 there still
+// excludes every other row. This is Knuth's exact cover with colors (XCC).
+void dlx_set_color(dlx_t dlx, int row, int col, int color);
+
+// Writes the instance's rows, columns, colors, optional columns and bounds to
+// a compact binary file in this machine's byte order, with labels[i] as the
+// label of row i unless labels is NULL. Rows removed are written empty, rows
+// picked as plain rows; forced rows, symmetries and settings are not written.
+// Returns 0 on success, -1 otherwise.
+int dlx_save(dlx_t dlx, const char *path, const char *const labels[]);
+
+// Returns a new instance read from a file written by dlx_save(), which is
+// mapped into memory and turned into the instance in one pass, or NULL if it
+// cannot be read, is malformed, has bounds below 0 or the wrong way round, or
+// was written in the other byte order. Unless labels is NULL, sets *labels to
+// an array of dlx_rows() labels, to be freed with one call to free(), or to
+// NULL if the file has none.
+dlx_t dlx_load(const char *path, char ***labels);
+
+// Removes a row from consideration. Returns 0 on success, or -1 if there is
+// no such row or it has been picked or clashes with a row picked, in which
+// case the instance is left as it was.
 // Should only be called after all dlx_set() calls.
 int dlx_remove_row(dlx_t p, int row);
 
-// Picks a row to be part of the solution. Returns 0 on success, -1 otherwise.
+// Picks a row to be part of the solution. Returns 0 on success, or -1 if
+// there is no such row or it clashes with a row already picked, in which
+// case the instance is left as it was.
 // Should only be called after all dlx_set() calls and dlx_remove_row() calls.
-// TODO: Check the row can be legally chosen.
 int dlx_pick_row(dlx_t dlx, int row);
 
+// What dlx_reduce() took out of an instance.
+struct dlx_reduce_s {
+    int forced;   // Rows every solution has, now picked.
+    int removed;  // Rows no solution has, now removed.
+    int merged;   // Columns covered whenever another is, now dropped.
+};
+
+// Shrinks the instance without changing its exact covers, repeating until
+// nothing more goes:
+//
+//  * a primary column with a single row forces that row, which is picked;
+//  * if every row of a primary column has another column, the other
+//    column's remaining rows are removed, and the column itself dropped;
+//  * a row that clashes with every row of some primary column, or has no
+//    primary column, is removed.
+//
+// Unlike rows given to dlx_pick_row(), forced rows are included in every
+// solution reported as a list of rows. Should be called after all dlx_set(),
+// dlx_set_color(), dlx_remove_row() and dlx_pick_row() calls. Does nothing to
+// an instance with bounds. Fills in *stats unless it is NULL. Returns 0, or
+// -1 if it finds a column no row can cover, so there are no exact covers.
+int dlx_reduce(dlx_t dlx, struct dlx_reduce_s *stats);
+
+// Marks the current state of the instance, so dlx_pop() can return to it.
+// Marks nest.
+void dlx_push(dlx_t dlx);
+
+// Undoes every dlx_pick_row(), dlx_remove_row() and dlx_reduce() since the
+// last outstanding dlx_push(), in reverse order, and drops that mark, so one
+// instance can serve many related searches. Other changes are not undone.
+// Returns 0 on success, or -1 if there is no mark.
+int dlx_pop(dlx_t dlx);
+
+// Declares a symmetry of the instance: perm[i], for each of the dlx_rows()
+// rows i, is the row it maps to. It must map exact covers to exact covers,
+// and rows picked or removed to rows picked or removed. Later searches then
+// report an exact cover only if it is lexicographically least among its
+// images, comparing sets of rows by the first row one has and the other
+// lacks in an order of the search's choosing (rows of a column every
+// symmetry fixes come first, so the search can branch on it at the root),
+// and prune branches as soon as the rows chosen so far rule that out.
+// If every element of the group other than the identity is declared, that
+// leaves one exact cover per orbit; declaring only some leaves at least one.
+// Searches with symmetries dance on links, and the memoized search ignores
+// them. Should be called after all dlx_set() calls. Returns 0 on success, or
+// -1 if perm is not a permutation.
+int dlx_add_symmetry(dlx_t dlx, const int perm[]);
+
+// What a search did, for comparing strategies, backends and instances. Depth
+// d means d rows chosen by the search, not counting those picked beforehand.
+enum { DLX_STATS_BRANCH = 16 };
+struct dlx_stats_s {
+    long long nodes;      // Nodes visited, dead ends and solutions included.
+    long long mems;       // Updates made: links changed, cells moved or rows
+                          // filtered, depending on the backend. Counted only
+                          // if the library is built with DLX_STATS defined,
+                          // and -1 otherwise.
+    long long stuck;      // Dead ends: nodes with a column no row can cover.
+    long long solutions;  // Exact covers found.
+    double seconds;       // Wall-clock time, callbacks included.
+    int depth;            // One more than the deepest depth reached.
+    // Nodes, exact covers and seconds at each depth below 'depth', where a
+    // node's time runs until the next node is entered. In a parallel search,
+    // the seconds add up over the threads.
+    long long *nodes_at, *solutions_at;
+    double *seconds_at;
+    // How many nodes branched i ways, for i < DLX_STATS_BRANCH - 1, and
+    // DLX_STATS_BRANCH - 1 ways or more.
+    long long branch[DLX_STATS_BRANCH];
+};
+
+// Turns the keeping of statistics on or off for later searches, which start
+// afresh. Off by default: when on, each node costs a few counts and a read of
+// the clock. The memoized search keeps none.
+void dlx_set_stats(dlx_t dlx, int on);
+
+// Sets *stats to the statistics of the last search, or the one under way.
+// Its arrays belong to the instance, and stay valid until the next search or
+// dlx_clear(). Returns 0 on success, or -1 if statistics are off.
+int dlx_get_stats(dlx_t dlx, struct dlx_stats_s *stats);
+
+// Writes statistics as a JSON object on one line, with no newline.
+void dlx_print_stats(FILE *fp, const struct dlx_stats_s *stats);
+
+// A read-only snapshot of an instance, from which many independent instances
+// can be stamped without building each one with dlx_set() calls.
+struct dlx_compiled_s;
+typedef struct dlx_compiled_s *dlx_compiled_t;
+
+// Returns a snapshot of the instance as it stands, picks, removals, bounds,
+// symmetries and settings included. The instance is left as it was, and may
+// be freed or modified without affecting the snapshot.
+dlx_compiled_t dlx_compile(dlx_t dlx);
+
+// Returns a new instance equal to the snapshot, made by copying a few arrays.
+// It is an ordinary instance, to be picked from, searched and freed with
+// dlx_clear(). Several threads may make instances from one snapshot at once.
+dlx_t dlx_state_new(dlx_compiled_t compiled);
+
+// Frees a snapshot. Instances made from it live on.
+void dlx_compiled_free(dlx_compiled_t compiled);
+
 // Runs the DLX algorithm, and for every exact cover, calls the given callback
 // with an array containing all the row numbers of the solution and the size of
 // said array.
@@ -58,3 +269,193 @@ void dlx_solve(dlx_t dlx,
                void (*uncover_cb)(),
                void (*found_cb)(),
                void (*stuck_cb)(int col));
+
+// Like dlx_forall_cover(), except the callback returns nonzero to stop the
+// search, and if max_solutions is positive, the search also stops after that
+// many exact covers. Either way, the instance is left as it was before the
+// call, so it can be searched again or freed. Returns the number of exact
+// covers found.
+int dlx_forall_cover_max(dlx_t dlx, int max_solutions, int (*cb)(int rows[], int n));
+
+// Like dlx_solve(), except found_cb returns nonzero to stop the search, and
+// the search stops after max_solutions exact covers if it is positive.
+// Returns the number of exact covers found.
+int dlx_solve_max(dlx_t dlx, int max_solutions,
+                  void (*cover_cb)(int col, int s, int row),
+                  void (*uncover_cb)(),
+                  int (*found_cb)(),
+                  void (*stuck_cb)(int col));
+
+// Looks for one exact cover by randomized search with restarts, for when any
+// solution will do: a random one, or the first of a hard instance, which a
+// little randomness often finds much sooner. Each run tries rows in a random
+// order and breaks ties between columns at random, and gives up after unit
+// times the next term of the Luby sequence 1 1 2 1 1 2 4 1 1 2 ... nodes,
+// whereupon the next run starts afresh; a unit of 0 or less means a single
+// run. The seeds of the runs come from seed, so the same seed gives the same
+// runs. Calls cb with the rows of the exact cover found, and returns 1, or
+// returns 0 if a run shows there is none, or -1 once the runs have visited
+// budget nodes in all, if budget is positive. Exact covers found this way are
+// not uniformly distributed; dlx_zdd_sample() draws uniformly. An instance
+// with bounds is searched just once, in order and without a budget.
+// Statistics, if on, add up over the runs.
+int dlx_solve_random(dlx_t dlx, uint64_t seed, long long unit, long long budget,
+                     void (*cb)(int rows[], int n));
+
+// Estimates of the size of a search, from dlx_estimate().
+struct dlx_estimate_s {
+    double nodes;      // Nodes the search would visit.
+    double solutions;  // Exact covers it would find.
+};
+
+// Estimates the size of the search by Knuth's method: each of the given
+// number of samples dives from the root to a leaf, choosing columns as the
+// search would and rows at random, seeded by seed, and counts every node on
+// the way as standing for the product of the numbers of choices above it.
+// The averages are unbiased, but for irregular trees may take many samples
+// to settle. Declared symmetries prune as they would in the search. Sets *est
+// and returns 0, or -1 for an instance with bounds, which it does not handle.
+int dlx_estimate(dlx_t dlx, int samples, uint64_t seed, struct dlx_estimate_s *est);
+
+// Makes later searches call cb after every 'every' nodes with the fraction
+// of the search tree explored so far and the number of nodes visited. The
+// fraction is worked out from the position of the row being tried among its
+// column's rows at each level, as if every subtree were the same size, so it
+// can run fast or slow but never goes backwards. Parallel searches and
+// searches with bounds do not report, and a NULL cb or an 'every' of 0 turns
+// reporting off.
+void dlx_set_progress(dlx_t dlx, long long every, void (*cb)(double done, long long nodes));
+
+// Splits the search into jobs that can run separately, cube-and-conquer
+// style: each node of the search tree at the given depth, and each exact
+// cover found above it, becomes a job, written to its own file named by
+// prefix followed by the job's number from 0. If depth is not positive, uses
+// the shallowest depth that gives at least count jobs, or the deepest there
+// is. The jobs partition the exact covers, so summing their counts gives the
+// count for the whole instance. Returns the number of jobs, or -1 if a file
+// cannot be written or the instance has bounds.
+int dlx_split(dlx_t dlx, int depth, int count, const char *prefix);
+
+// Reads a job written by dlx_split() for this instance and picks its rows,
+// which then go in every solution, as those dlx_reduce() forces do, until
+// undone by dlx_pop(). Returns 0, or -1 if the file cannot be read, was
+// written for a different instance, or its rows conflict, in which case the
+// instance is left as it was.
+int dlx_pick_job(dlx_t dlx, const char *path);
+
+// Makes later serial searches write their position to the file at path
+// every 'every' nodes: the row being tried on each level, and how many
+// solutions and nodes came before. They also write one when they finish, or
+// stop early, at the solution they stopped at. Each file replaces the last
+// one whole, by renaming. Searches with bounds, DLX_WDEG or DLX_ORDER_RANDOM
+// do not write them, as they could not be replayed, and searches that do
+// write them never dance on cells. A NULL path or an 'every' of 0 turns
+// checkpoints off.
+void dlx_set_checkpoint(dlx_t dlx, const char *path, long long every);
+
+// Reads a checkpoint written by a search of this instance, with the same
+// rows picked and removed and the same settings, so that the next serial
+// search starts where that one left off: no solution it reported before
+// writing the checkpoint is reported again, though those it reported after
+// are. Counts in later checkpoints carry on from it. Returns the number of
+// solutions reported before the checkpoint, or -1 if the file cannot be read
+// or does not fit the instance.
+long long dlx_resume(dlx_t dlx, const char *path);
+
+// A batch of exact covers, for callers that would rather take many at a time
+// than be called once per solution: solution i of the n in the batch is
+// rows[off[i]] to rows[off[i + 1] - 1]. The arrays must have room for cap + 1
+// offsets and rows_cap rows.
+struct dlx_batch_s {
+    int *off, *rows;
+    int cap, rows_cap;
+    int n;
+};
+
+// Like dlx_forall_cover_max() with no limit, but copies the exact covers into
+// the caller's batch and calls cb with it whenever it is full: when it holds
+// cap solutions, or has no room for another as long as the last. The rest go
+// at the end. If cb returns nonzero, the search stops. Checkpoints are only
+// written as a batch is handed over. Returns the number of exact covers
+// handed over, or -1 if cap is not positive or a solution does not fit in an
+// empty batch.
+long dlx_forall_cover_batch(dlx_t dlx, struct dlx_batch_s *batch, int (*cb)(struct dlx_batch_s *batch));
+
+// Like dlx_forall_cover_parallel(), but each thread fills a batch of its own,
+// of the given sizes, so it only takes the lock to hand over a full one.
+// Calls to cb are serialized. If cb returns nonzero, the search stops, and
+// solutions in other threads' batches are dropped. Returns the number of
+// exact covers handed over, or -1 if cap is not positive or a solution does
+// not fit in an empty batch.
+long dlx_forall_cover_parallel_batch(dlx_t dlx, int nthreads, int cap, int rows_cap,
+                                     int (*cb)(struct dlx_batch_s *batch));
+
+// A cursor over the exact covers of an instance, for callers that would
+// rather pull solutions one at a time than receive them in a callback.
+struct dlx_iter_s;
+typedef struct dlx_iter_s *dlx_iter_t;
+
+// Returns a cursor positioned before the first exact cover. The search state
+// lives in the instance's links, so the instance must not be modified or
+// searched until the cursor is freed.
+dlx_iter_t dlx_iter_new(dlx_t dlx);
+
+// Finds the next exact cover, in the same order as dlx_forall_cover().
+// Returns 1 and sets *rows and *n to the rows of the solution, which stay
+// valid until the next call. Returns 0 once there are no more solutions.
+int dlx_iter_next(dlx_iter_t it, int **rows, int *n);
+
+// Frees the cursor and restores the instance, whether or not the search ran
+// to the end.
+void dlx_iter_free(dlx_iter_t it);
+
+// Like dlx_forall_cover_max() with no limit, but searches on the given number
+// of threads, or one per online processor if nthreads is not positive. Each
+// thread dances on its own copy of the links, and an idle thread takes over
+// the untried rows of a busy one. Calls to cb are serialized, but solutions
+// arrive in no particular order. The callback may be NULL. Returns the number
+// of exact covers reported.
+long dlx_forall_cover_parallel(dlx_t dlx, int nthreads, int (*cb)(int rows[], int n));
+
+// Exact counts, which can outgrow 64 bits.
+typedef unsigned __int128 dlx_count_t;
+
+// Writes n in decimal to buf, which must hold 40 bytes. Returns buf.
+char *dlx_count_str(dlx_count_t n, char buf[40]);
+
+// A ZDD (zero-suppressed decision diagram) holding every exact cover of an
+// instance, built by Knuth's Algorithm DXZ: the same uncovered columns are
+// often reached through different sequences of rows, so the search memoizes
+// the result for each set of covered columns instead of searching it again.
+struct dlx_zdd_s;
+typedef struct dlx_zdd_s *dlx_zdd_t;
+
+// Searches the instance and returns a ZDD of all its exact covers. The
+// instance is left as it was.
+dlx_zdd_t dlx_zdd_new(dlx_t dlx);
+
+// Frees a ZDD.
+void dlx_zdd_free(dlx_zdd_t zdd);
+
+// Returns the number of exact covers in the ZDD.
+dlx_count_t dlx_zdd_count(dlx_zdd_t zdd);
+
+// Returns the number of nodes in the ZDD.
+int dlx_zdd_size(dlx_zdd_t zdd);
+
+// Returns the number of rows in the largest exact cover in the ZDD.
+int dlx_zdd_depth(dlx_zdd_t zdd);
+
+// Calls cb on every exact cover in the ZDD, in the order dlx_forall_cover()
+// finds them, until cb returns nonzero. The callback may be NULL. Returns the
+// number of exact covers visited.
+dlx_count_t dlx_zdd_forall(dlx_zdd_t zdd, int (*cb)(int rows[], int n));
+
+// Writes the rows of an exact cover chosen uniformly at random into rows,
+// which must hold dlx_zdd_depth() ints, and returns how many there are, or
+// -1 if there are none. The generator state *seed is advanced, so the same
+// seed gives the same sequence of samples.
+int dlx_zdd_sample(dlx_zdd_t zdd, uint64_t *seed, int rows[]);
+
+// Returns the number of exact covers, counted with the memoized search.
+dlx_count_t dlx_count(dlx_t dlx);
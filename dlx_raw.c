@@ -1,4 +1,5 @@
 #include <ctype.h>
+#include <getopt.h>
 #include <string.h>
 #include <stdarg.h>
 #include <stdio.h>
@@ -6,37 +7,127 @@
 #include <time.h>
 #include "dlx.h"
 
-int main(int argc, char const** argv)
+int main(int argc, char** argv)
 {
-    dlx_t dlx = dlx_new();
+    // --dump-matrix=FILE saves the matrix read, and --load-matrix=FILE reads
+    // one saved earlier instead of standard input. --stats prints statistics
+    // of the search on stderr as JSON. --split=N writes the search out as at
+    // least N jobs, in files job.0, job.1, ..., instead of solving it, and
+    // --job=FILE solves just the part of the search in one of them.
+    // --checkpoint=FILE saves the position of the search in FILE now and
+    // then, and resumes from it if it is there.
+    char const* dump = NULL;
+    char const* load = NULL;
+    char const* job = NULL;
+    char const* checkpoint = NULL;
+    int stats = 0, split = 0;
+    static struct option longopts[] = {
+        { "dump-matrix", required_argument, NULL, 'd' },
+        { "load-matrix", required_argument, NULL, 'l' },
+        { "stats", no_argument, NULL, 's' },
+        { "split", required_argument, NULL, 'S' },
+        { "job", required_argument, NULL, 'j' },
+        { "checkpoint", required_argument, NULL, 'c' },
+        { NULL, 0, NULL, 0 },
+    };
+    int opt;
+    while ((opt = getopt_long(argc, argv, "", longopts, NULL)) != -1) {
+        if (opt == 'd') dump = optarg;
+        else if (opt == 'l') load = optarg;
+        else if (opt == 's') stats = 1;
+        else if (opt == 'S') split = atoi(optarg);
+        else if (opt == 'j') job = optarg;
+        else if (opt == 'c') checkpoint = optarg;
+        else {
+            fprintf(stderr, "Usage: %s [--dump-matrix=FILE | --load-matrix=FILE] [--stats]"
+                    " [--split=N | --job=FILE] [--checkpoint=FILE]\n", *argv);
+            return 1;
+        }
+    }
+    dlx_t dlx = load ? dlx_load(load, NULL) : dlx_new();
+    if (!dlx) {
+        fprintf(stderr, "%s: cannot load matrix\n", load);
+        return 1;
+    }
     int ncols = -1;
     int row = 0;
     char line[1024];
-    while (fgets(line, sizeof(line), stdin) != NULL) {
+    while (!load && fgets(line, sizeof(line), stdin) != NULL) {
         if (line[strlen(line)-1] == '\n')
             line[strlen(line)-1] = '\0';
         char const* p = line + strspn(line, " ");
         if (*p == '\0' || *p == '#')
             continue;
-        int col = 0;
+        int col = 0, cols[sizeof(line)], n = 0;
         for (; *p != '\0'; ++col) {
             if (*p++ == '1')
-                dlx_set(dlx, row, col);
+                cols[n++] = col;
             while (*p == ' ')
                 ++p;
         }
+        dlx_add_row(dlx, cols, n);
         if (ncols >= 0 && col != ncols)
             fprintf(stderr, "WARNING: row %d has %d columns rather than %d\n", row, col, ncols);
         ncols = col;
         ++row;
     }
+    if (dump && dlx_save(dlx, dump, NULL)) {
+        fprintf(stderr, "%s: cannot save matrix\n", dump);
+        return 1;
+    }
+
+    if (split > 0) {
+        int n = dlx_split(dlx, 0, split, "job.");
+        if (n < 0) {
+            fprintf(stderr, "cannot write jobs\n");
+            return 1;
+        }
+        printf("%d jobs\n", n);
+        dlx_clear(dlx);
+        return 0;
+    }
+    if (job && dlx_pick_job(dlx, job)) {
+        fprintf(stderr, "%s: not a job for this matrix\n", job);
+        return 1;
+    }
+    if (checkpoint) {
+        FILE* fp = fopen(checkpoint, "r");
+        if (fp) {
+            fclose(fp);
+            long long n = dlx_resume(dlx, checkpoint);
+            if (n < 0) {
+                fprintf(stderr, "%s: not a checkpoint of this search\n", checkpoint);
+                return 1;
+            }
+            fprintf(stderr, "resuming after %lld solutions\n", n);
+        }
+        dlx_set_checkpoint(dlx, checkpoint, 1 << 22);
+    }
 
-    void prt(int row[], int n) {
-        for (int i = 0; i < n; ++i)
-            printf(" %d", row[i]);
-        printf("\n");
+    // Solutions come in batches, so printing them costs one call per batch.
+    int prt(struct dlx_batch_s* b) {
+        for (int k = 0; k < b->n; ++k) {
+            for (int i = b->off[k]; i < b->off[k + 1]; ++i)
+                printf(" %d", b->rows[i]);
+            printf("\n");
+        }
+        return 0;
+    }
+    struct dlx_batch_s batch;
+    batch.cap = 4096;
+    // Every row of a solution covers a column of its own.
+    batch.rows_cap = dlx_cols(dlx) + 1 > 1 << 16 ? dlx_cols(dlx) + 1 : 1 << 16;
+    batch.off = malloc(sizeof(int) * (batch.cap + 1));
+    batch.rows = malloc(sizeof(int) * batch.rows_cap);
+    dlx_set_stats(dlx, stats);
+    dlx_forall_cover_batch(dlx, &batch, prt);
+    free(batch.off);
+    free(batch.rows);
+    struct dlx_stats_s st;
+    if (!dlx_get_stats(dlx, &st)) {
+        dlx_print_stats(stderr, &st);
+        fputc('\n', stderr);
     }
-    dlx_forall_cover(dlx, prt);
     dlx_clear(dlx);
     return 0;
 }
@@ -1,8 +1,12 @@
 #include <ctype.h>
+#include <math.h>
+#include <pthread.h>
 #include <stdarg.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <time.h>
+#include <unistd.h>
 #include "dlx.h"
 
 #define F(i,n) for(int i = 0; i < n; i++)
@@ -281,6 +285,1431 @@ void test_readme_example() {
     dlx_clear(dlx);
 }
 
+void test_iter() {
+    // Pull the exact covers of test_counter() one at a time.
+    dlx_t dlx = dlx_new();
+    F(i, 10) dlx_set(dlx, i, 0);
+    F(i, 3) dlx_set(dlx, 10 + i, 1);
+    dlx_iter_t it = dlx_iter_new(dlx);
+    int *r, n, counter = 0;
+    while (counter < 12 && dlx_iter_next(it, &r, &n)) {
+        EXPECT(n == 2);
+        EXPECT(r[1] + 10*(r[0] - 10) == counter++);
+    }
+    EXPECT(12 == counter);
+    // Drop the rest.
+    dlx_iter_free(it);
+
+    // The instance was restored, so a new cursor starts over and runs dry.
+    it = dlx_iter_new(dlx);
+    counter = 0;
+    while (dlx_iter_next(it, &r, &n)) EXPECT(r[1] + 10*(r[0] - 10) == counter++);
+    EXPECT(30 == counter);
+    EXPECT(!dlx_iter_next(it, &r, &n));
+    dlx_iter_free(it);
+    dlx_clear(dlx);
+}
+
+void test_deep() {
+    // A million rows and a search 5000 levels deep: neither may live on the
+    // stack.
+    dlx_t dlx = dlx_new();
+    F(i, 5000) F(j, 200) dlx_set(dlx, 200*i + j, i);
+    EXPECT(1000000 == dlx_rows(dlx));
+    int f(int r[], int n) {
+        EXPECT(n == 5000);
+        F(i, n) EXPECT(r[i] == 200*i);
+        return 0;
+    }
+    EXPECT(1 == dlx_forall_cover_max(dlx, 1, f));
+    dlx_clear(dlx);
+}
+
+void test_parallel() {
+    // All permutations of 6 characters, as in test_perm().
+    dlx_t dlx = dlx_new();
+    F(i, 6) F(j, 6) {
+        dlx_set(dlx, 6*i + j, i);
+        dlx_set(dlx, 6*i + j, 6 + j);
+    }
+    char seen[6*6*6*6*6*6] = { 0 };
+    int counter = 0;
+    int f(int r[], int n) {
+        EXPECT(n == 6);
+        int index = 0;
+        F(i, n) index += (r[i]%6) * (int[]){1, 6, 36, 216, 1296, 7776}[r[i]/6];
+        EXPECT(!seen[index]++);
+        counter++;
+        return 0;
+    }
+    EXPECT(720 == dlx_forall_cover_parallel(dlx, 4, f));
+    EXPECT(720 == counter);
+    // The links are back as they were.
+    EXPECT(720 == dlx_forall_cover_parallel(dlx, 3, 0));
+    counter = 0;
+    int stop(int r[], int n) { return ++counter == 100; }
+    EXPECT(100 == dlx_forall_cover_parallel(dlx, 4, stop));
+    EXPECT(100 == counter);
+    counter = 0;
+    void g(int r[], int n) { counter++; }
+    dlx_forall_cover(dlx, g);
+    EXPECT(720 == counter);
+    dlx_clear(dlx);
+
+    // One row per column leaves nothing to hand over, so the other workers
+    // are asleep when the only solution stops the search.
+    dlx = dlx_new();
+    F(i, 2000) dlx_add_row(dlx, (int[]){i}, 1);
+    int first(int r[], int n) { return 1; }
+    F(iter, 20) EXPECT(1 == dlx_forall_cover_parallel(dlx, 4, first));
+    dlx_clear(dlx);
+}
+
+void test_max() {
+    dlx_t dlx = dlx_new();
+    F(i, 4) F(j, 4) {
+        dlx_set(dlx, 4*i + j, i);
+        dlx_set(dlx, 4*i + j, 4 + j);
+    }
+    int counter = 0;
+    int f(int r[], int n) {
+        counter++;
+        return 0;
+    }
+    EXPECT(5 == dlx_forall_cover_max(dlx, 5, f));
+    EXPECT(5 == counter);
+    // Stop from the callback, mid-search.
+    counter = 0;
+    int g(int r[], int n) { return ++counter == 7; }
+    EXPECT(7 == dlx_forall_cover_max(dlx, 0, g));
+    // The links were unwound, so a full search still sees everything.
+    counter = 0;
+    EXPECT(24 == dlx_forall_cover_max(dlx, 0, f));
+    EXPECT(24 == counter);
+    // A uniqueness check only needs to look for a second solution.
+    dlx_pick_row(dlx, 0);
+    dlx_pick_row(dlx, 5);
+    dlx_pick_row(dlx, 10);
+    EXPECT(1 == dlx_forall_cover_max(dlx, 2, f));
+    dlx_clear(dlx);
+}
+
+void test_zdd() {
+    // The ZDD of test_perm() holds the same covers, in the same order.
+    dlx_t dlx = dlx_new();
+    F(i, 6) F(j, 6) {
+        dlx_set(dlx, 6*i + j, i);
+        dlx_set(dlx, 6*i + j, 6 + j);
+    }
+    int sols[720][6], counter = 0;
+    void f(int r[], int n) {
+        EXPECT(n == 6);
+        memcpy(sols[counter++], r, sizeof(*sols));
+    }
+    dlx_forall_cover(dlx, f);
+    EXPECT(720 == counter);
+    dlx_zdd_t zdd = dlx_zdd_new(dlx);
+    EXPECT(720 == dlx_zdd_count(zdd));
+    counter = 0;
+    int g(int r[], int n) {
+        EXPECT(n == 6);
+        EXPECT(!memcmp(sols[counter++], r, sizeof(*sols)));
+        return 0;
+    }
+    EXPECT(720 == dlx_zdd_forall(zdd, g));
+    // Samples are exact covers, and a seed fixes the sequence.
+    uint64_t seed = 1, seed2 = 1;
+    F(k, 100) {
+        int r[6], r2[6];
+        EXPECT(6 == dlx_zdd_sample(zdd, &seed, r));
+        EXPECT(6 == dlx_zdd_sample(zdd, &seed2, r2));
+        EXPECT(!memcmp(r, r2, sizeof(r)));
+        int used = 0;
+        F(i, 6) used |= 1 << r[i]/6 | 1 << (6 + r[i]%6);
+        EXPECT(used == 07777);
+    }
+    dlx_zdd_free(zdd);
+    // The search left the links alone.
+    counter = 0;
+    dlx_forall_cover(dlx, f);
+    EXPECT(720 == counter);
+    dlx_clear(dlx);
+
+    // 4^40 covers: too many to enumerate, or to count in 64 bits, but the
+    // memoized search only sees 40 subproblems.
+    dlx = dlx_new();
+    F(i, 40) F(j, 4) dlx_set(dlx, 4*i + j, i);
+    dlx_count_t n = dlx_count(dlx);
+    EXPECT(n == (dlx_count_t)1 << 80);
+    char buf[40];
+    EXPECT(!strcmp("1208925819614629174706176", dlx_count_str(n, buf)));
+    EXPECT(!strcmp("0", dlx_count_str(0, buf)));
+    dlx_clear(dlx);
+
+    // The longest covers reach a shared node through more rows than the
+    // first cover to get there.
+    dlx = dlx_new();
+    dlx_add_row(dlx, (int[]){0, 1, 2, 3, 4, 5}, 6);
+    F(i, 3) dlx_add_row(dlx, (int[]){2*i, 2*i + 1}, 2);
+    F(i, 2) dlx_add_row(dlx, (int[]){6}, 1);
+    zdd = dlx_zdd_new(dlx);
+    EXPECT(4 == dlx_zdd_count(zdd));
+    EXPECT(4 == dlx_zdd_depth(zdd));
+    int lens = 0;
+    int h(int r[], int n) {
+        EXPECT(n == 2 || n == 4);
+        lens += n;
+        return 0;
+    }
+    EXPECT(4 == dlx_zdd_forall(zdd, h));
+    EXPECT(12 == lens);
+    F(k, 20) {
+        int r[4], n = dlx_zdd_sample(zdd, &seed, r);
+        EXPECT(n == 2 || n == 4);
+    }
+    dlx_zdd_free(zdd);
+    dlx_clear(dlx);
+
+    // No covers at all.
+    dlx = dlx_new();
+    dlx_set(dlx, 0, 0);
+    dlx_set(dlx, 0, 1);
+    dlx_set(dlx, 1, 1);
+    dlx_set(dlx, 1, 2);
+    zdd = dlx_zdd_new(dlx);
+    EXPECT(0 == dlx_zdd_count(zdd));
+    EXPECT(0 == dlx_zdd_forall(zdd, 0));
+    EXPECT(-1 == dlx_zdd_sample(zdd, &seed, (int[2]){}));
+    dlx_zdd_free(zdd);
+    dlx_clear(dlx);
+}
+
+void test_choice() {
+    // Ties go to the first column, and optional columns are never chosen
+    // however small they are.
+    dlx_t dlx = dlx_new();
+    int rows[][3] = { {0, 1, -1}, {0, 2, -1}, {1, 2, 3}, {2, -1, -1} };
+    F(i, 4) F(j, 3) if (rows[i][j] >= 0) dlx_set(dlx, i, rows[i][j]);
+    dlx_mark_optional(dlx, 3);
+    char log[64], *s = log;
+    void try(int c, int size, int r) { s += sprintf(s, "t%d%d%d ", c, size, r); }
+    void found() { s += sprintf(s, "f "); }
+    void stuck(int c) { s += sprintf(s, "s%d ", c); }
+    dlx_solve(dlx, try, 0, found, stuck);
+    EXPECT(!strcmp(log, "t020 t213 f t021 s1 "));
+    dlx_clear(dlx);
+
+    // Weighting columns changes the order of the search, not its results.
+    dlx = dlx_new();
+    F(i, 6) F(j, 6) {
+        dlx_set(dlx, 6*i + j, i);
+        dlx_set(dlx, 6*i + j, 6 + j);
+    }
+    dlx_set_strategy(dlx, DLX_WDEG);
+    char seen[6*6*6*6*6*6] = { 0 };
+    int counter = 0;
+    void f(int r[], int n) {
+        int index = 0;
+        F(i, n) index += (r[i]%6) * (int[]){1, 6, 36, 216, 1296, 7776}[r[i]/6];
+        EXPECT(!seen[index]++);
+        counter++;
+    }
+    dlx_forall_cover(dlx, f);
+    EXPECT(720 == counter);
+    // Three columns that pairs of rows can never cover exactly.
+    dlx_set(dlx, 36, 12), dlx_set(dlx, 36, 13);
+    dlx_set(dlx, 37, 13), dlx_set(dlx, 37, 14);
+    dlx_set(dlx, 38, 12), dlx_set(dlx, 38, 14);
+    EXPECT(0 == dlx_forall_cover_max(dlx, 0, 0));
+    dlx_clear(dlx);
+}
+
+void test_row_order() {
+    dlx_t dlx = dlx_new();
+    F(i, 6) F(j, 6) {
+        dlx_set(dlx, 6*i + j, i);
+        dlx_set(dlx, 6*i + j, 6 + j);
+    }
+    int sols[3][720][6], counter;
+    void f(int r[], int n) { memcpy(sols[2][counter++], r, sizeof(**sols)); }
+    int sorted(const void *x, const void *y) { return memcmp(x, y, sizeof(**sols)); }
+    // Every order finds the same covers, and a seed fixes the random order.
+    F(k, 3) {
+        dlx_set_row_order(dlx, k, 42);
+        counter = 0;
+        dlx_forall_cover(dlx, f);
+        EXPECT(720 == counter);
+        if (k == DLX_ORDER_RANDOM) {
+            memcpy(sols[0], sols[2], sizeof(*sols));
+            counter = 0;
+            dlx_forall_cover(dlx, f);
+            EXPECT(!memcmp(sols[0], sols[2], sizeof(*sols)));
+            dlx_set_row_order(dlx, k, 43);
+            counter = 0;
+            dlx_forall_cover(dlx, f);
+            EXPECT(memcmp(sols[0], sols[2], sizeof(*sols)));
+        }
+        qsort(sols[2], 720, sizeof(**sols), sorted);
+        if (k) EXPECT(!memcmp(sols[1], sols[2], sizeof(*sols)));
+        memcpy(sols[1], sols[2], sizeof(*sols));
+    }
+    EXPECT(720 == dlx_forall_cover_parallel(dlx, 3, 0));
+    dlx_clear(dlx);
+
+    // Column 0 is chosen first. Row 0 leaves one way to cover column 1,
+    // while row 1 leaves two ways to cover column 2, so the least
+    // constraining order tries row 1 first.
+    dlx = dlx_new();
+    dlx_set(dlx, 0, 0), dlx_set(dlx, 0, 1);
+    dlx_set(dlx, 1, 0), dlx_set(dlx, 1, 2);
+    dlx_set(dlx, 2, 1);
+    dlx_set(dlx, 3, 2);
+    dlx_set(dlx, 4, 2);
+    int first[2];
+    int g(int r[], int n) {
+        first[0] = r[0];
+        return 1;
+    }
+    EXPECT(1 == dlx_forall_cover_max(dlx, 0, g));
+    EXPECT(first[0] == 0);
+    dlx_set_row_order(dlx, DLX_ORDER_LEAST_CONSTRAINING, 0);
+    EXPECT(1 == dlx_forall_cover_max(dlx, 0, g));
+    EXPECT(first[0] == 1);
+    dlx_clear(dlx);
+}
+
+void test_color() {
+    // Knuth's example: items p, q, r, with secondary items x and y, and the
+    // options 'p q x y:A', 'p r x:A y', 'p x:B', 'q x:A', 'r y:B'.
+    dlx_t dlx = dlx_new();
+    enum { p, q, r, x, y, A = 1, B };
+    dlx_set(dlx, 0, p), dlx_set(dlx, 0, q), dlx_set(dlx, 0, x);
+    dlx_set_color(dlx, 0, y, A);
+    dlx_set(dlx, 1, p), dlx_set(dlx, 1, r), dlx_set_color(dlx, 1, x, A);
+    dlx_set(dlx, 1, y);
+    dlx_set(dlx, 2, p), dlx_set_color(dlx, 2, x, B);
+    dlx_set(dlx, 3, q), dlx_set_color(dlx, 3, x, A);
+    dlx_set(dlx, 4, r), dlx_set_color(dlx, 4, y, B);
+    int counter = 0;
+    void f(int row[], int n) {
+        EXPECT(n == 2);
+        EXPECT(row[0] + row[1] == 4 && (row[0] == 1 || row[0] == 3));
+        counter++;
+    }
+    dlx_forall_cover(dlx, f);
+    EXPECT(1 == counter);
+    EXPECT(1 == dlx_count(dlx));
+    EXPECT(1 == dlx_forall_cover_parallel(dlx, 2, 0));
+    dlx_clear(dlx);
+
+    // Six primary columns, each with a row per color of one shared column:
+    // the solutions are the 3 ways to pick one color for all of them.
+    dlx = dlx_new();
+    F(i, 6) F(k, 3) {
+        dlx_set(dlx, 3*i + k, i);
+        dlx_set_color(dlx, 3*i + k, 6, k + 1);
+    }
+    int picked = 0;
+    counter = 0;
+    void g(int row[], int n) {
+        EXPECT(n + picked == 6);
+        F(i, n) EXPECT(row[i] % 3 == (picked ? 1 : row[0] % 3));
+        counter++;
+    }
+    dlx_forall_cover(dlx, g);
+    EXPECT(3 == counter);
+    EXPECT(3 == dlx_count(dlx));
+    // A picked row fixes the color.
+    dlx_pick_row(dlx, 4);
+    picked = 1;
+    counter = 0;
+    dlx_forall_cover(dlx, g);
+    EXPECT(1 == counter);
+    dlx_clear(dlx);
+}
+
+void test_bounds() {
+    // Two of four rows for one column: each pair once, in either order.
+    dlx_t dlx = dlx_new();
+    F(i, 4) dlx_set(dlx, i, 0);
+    dlx_set_bounds(dlx, 0, 2, 2);
+    int counter = 0;
+    void f(int r[], int n) {
+        EXPECT(n == 2 && r[0] < r[1]);
+        counter++;
+    }
+    dlx_forall_cover(dlx, f);
+    EXPECT(6 == counter);
+    dlx_set_bounds(dlx, 0, 1, 3);
+    EXPECT(4 + 6 + 4 == dlx_count(dlx));
+    // Bounds on a column that was optional make it primary again.
+    dlx_mark_optional(dlx, 0);
+    dlx_set_bounds(dlx, 0, 1, 2);
+    EXPECT(4 + 6 == dlx_count(dlx));
+    dlx_set_bounds(dlx, 0, 0, 1);
+    dlx_set_bounds(dlx, 0, 2, 2);
+    EXPECT(6 == dlx_count(dlx));
+    // Back to no bounds, and to the memoized search.
+    dlx_set_bounds(dlx, 0, 1, 1);
+    dlx_zdd_t zdd = dlx_zdd_new(dlx);
+    EXPECT(zdd && 4 == dlx_zdd_count(zdd));
+    dlx_zdd_free(zdd);
+    dlx_set_bounds(dlx, 0, 0, 1);
+    zdd = dlx_zdd_new(dlx);
+    EXPECT(zdd && 1 == dlx_zdd_count(zdd));
+    dlx_zdd_free(zdd);
+    dlx_clear(dlx);
+
+    // Bounds on a colored column: its colors no longer matter.
+    dlx = dlx_new();
+    F(i, 3) dlx_set_color(dlx, i, 0, 1 + i % 2);
+    dlx_set_bounds(dlx, 0, 1, 2);
+    EXPECT(3 + 3 == dlx_count(dlx));
+    dlx_clear(dlx);
+
+    // Random instances against brute force, with some rows picked and some
+    // optional and colored columns thrown in.
+    srand(1);
+    F(iter, 300) {
+        int rows = 1 + rand() % 12, cols = 1 + rand() % 5, m[12][6] = {{0}};
+        int lo[6], hi[6], picked = rand() % 3 ? -1 : rand() % rows;
+        dlx = dlx_new();
+        F(c, cols) {
+            lo[c] = rand() % 3, hi[c] = lo[c] + rand() % 3;
+            if (!hi[c]) hi[c] = 1;
+            dlx_set_bounds(dlx, c, lo[c], hi[c]);
+        }
+        F(r, rows) {
+            F(c, cols) if (rand() % 3 == 0) dlx_set(dlx, r, c), m[r][c] = 1;
+            if (rand() % 2) dlx_set_color(dlx, r, cols, m[r][cols] = 1 + rand() % 2);
+        }
+        // Setting bounds again on a column made optional meanwhile.
+        F(c, cols) if (rand() % 4 == 0) {
+            dlx_mark_optional(dlx, c);
+            dlx_set_bounds(dlx, c, lo[c], hi[c]);
+        }
+        // Rows with no primary column can never be chosen, and bounds (0, 1)
+        // make a column optional.
+        int bare = 0;
+        F(r, rows) {
+            int k = 0;
+            F(c, cols) k += m[r][c] && (lo[c] || hi[c] > 1);
+            if (!k) bare |= 1 << r;
+        }
+        if (picked >= 0 && (m[picked][cols] || bare >> picked & 1)) picked = -1;
+        int ok(int set) {
+            if (picked >= 0 && !(set >> picked & 1)) return 0;
+            int color = 0;
+            F(c, cols) {
+                int k = 0;
+                F(r, rows) k += (set >> r & 1) && m[r][c];
+                if (k < lo[c] || k > hi[c]) return 0;
+            }
+            F(r, rows) if (set >> r & 1 && m[r][cols]) {
+                if (color && color != m[r][cols]) return 0;
+                color = m[r][cols];
+            }
+            return 1;
+        }
+        int expected = 0;
+        F(set, 1 << rows) expected += !(set & bare) && ok(set);
+        if (picked >= 0) dlx_pick_row(dlx, picked);
+        char seen[1 << 12] = { 0 };
+        counter = 0;
+        void g(int r[], int n) {
+            int set = picked >= 0 ? 1 << picked : 0;
+            F(i, n) set |= 1 << r[i];
+            EXPECT(ok(set));
+            EXPECT(!seen[set]++);
+            counter++;
+        }
+        // Stop early first, to check that abandoning a search restores it.
+        dlx_forall_cover_max(dlx, 1, 0);
+        dlx_forall_cover(dlx, g);
+        EXPECT(counter == expected);
+        dlx_clear(dlx);
+    }
+}
+
+void test_backend() {
+    // Random instances with optional and colored columns, and some rows
+    // picked or removed: dancing cells must find the same exact covers as
+    // dancing links, after the same number of nodes.
+    srand(2);
+    F(iter, 300) {
+        int rows = 1 + rand() % 16, cols = 1 + rand() % 6;
+        int m[16][8] = {{0}};
+        dlx_t dlx[2];
+        F(b, 2) {
+            dlx[b] = dlx_new();
+            dlx_set_backend(dlx[b], b ? DLX_CELLS : DLX_LINKS);
+        }
+        F(r, rows) F(c, cols + 2) if (rand() % 3 == 0) {
+            m[r][c] = c < cols ? 1 : 1 + rand() % 3;
+        }
+        F(b, 2) {
+            F(r, rows) F(c, cols + 2) if (m[r][c]) {
+                if (c < cols || m[r][c] == 1) dlx_set(dlx[b], r, c);
+                else dlx_set_color(dlx[b], r, c, m[r][c]);
+            }
+            F(c, 2) dlx_mark_optional(dlx[b], cols + c);
+        }
+        int removed = rand() % rows, picked = rand() % rows;
+        if (rand() % 2) F(b, 2) dlx_remove_row(dlx[b], removed);
+        // Only pick rows that have a primary column, as the links would.
+        int primary = 0;
+        F(c, cols) primary |= m[picked][c];
+        if (primary && picked != removed && rand() % 2) {
+            F(b, 2) dlx_pick_row(dlx[b], picked);
+        }
+        int sols[2][64], count[2] = { 0 }, nodes[2] = { 0 };
+        F(b, 2) {
+            void f(int row[], int n) {
+                int set = 0;
+                F(i, n) set |= 1 << row[i];
+                if (count[b] < 64) sols[b][count[b]] = set;
+                count[b]++;
+            }
+            void try(int c, int s, int r) { nodes[b]++; }
+            dlx_forall_cover_max(dlx[b], 1, 0);
+            dlx_forall_cover(dlx[b], f);
+            dlx_solve(dlx[b], try, 0, 0, 0);
+        }
+        EXPECT(count[0] == count[1]);
+        EXPECT(nodes[0] == nodes[1]);
+        int cmp(const void *x, const void *y) { return *(int *)x - *(int *)y; }
+        int n = count[0] < 64 ? count[0] : 64;
+        F(b, 2) qsort(sols[b], n, sizeof(int), cmp);
+        EXPECT(!memcmp(sols[0], sols[1], sizeof(int) * n));
+        // The cursor stops early and resumes, and so does dlx_set_strategy().
+        dlx_iter_t it = dlx_iter_new(dlx[1]);
+        int *row, k = 0;
+        while (dlx_iter_next(it, &row, &n)) k++;
+        dlx_iter_free(it);
+        EXPECT(k == count[0]);
+        dlx_set_strategy(dlx[1], DLX_WDEG);
+        EXPECT(count[0] == dlx_forall_cover_max(dlx[1], 0, 0));
+        F(b, 2) dlx_clear(dlx[b]);
+    }
+}
+
+void test_bits() {
+    // Random instances, some too wide for a single word: bitsets must find
+    // the same exact covers as dancing links, in the same order, trying the
+    // same rows along the way.
+    srand(3);
+    F(iter, 300) {
+        int rows = 1 + rand() % 24, cols = 1 + rand() % (iter % 3 ? 8 : 150);
+        dlx_t dlx[2];
+        F(b, 2) {
+            dlx[b] = dlx_new();
+            dlx_set_backend(dlx[b], b ? DLX_BITS : DLX_LINKS);
+        }
+        F(r, rows) {
+            int n = 1 + rand() % 3;
+            F(k, n) {
+                int c = rand() % (cols + 2);
+                F(b, 2) dlx_set(dlx[b], r, c);
+            }
+        }
+        F(b, 2) F(c, 2) dlx_mark_optional(dlx[b], cols + c);
+        int removed = rand() % rows;
+        if (rand() % 2) F(b, 2) dlx_remove_row(dlx[b], removed);
+        uint64_t hash[2] = { 0 }, sols[2] = { 0 };
+        F(b, 2) {
+            int f(int row[], int n) {
+                F(i, n) sols[b] = sols[b] * 31 + row[i];
+                sols[b]++;
+                return 0;
+            }
+            void try(int c, int s, int r) { hash[b] = (hash[b] * 31 + c) * 31 + s + r; }
+            void undo() { hash[b] = hash[b] * 31 + 1; }
+            dlx_forall_cover_max(dlx[b], 0, f);
+            dlx_solve(dlx[b], try, undo, 0, 0);
+        }
+        EXPECT(sols[0] == sols[1]);
+        EXPECT(hash[0] == hash[1]);
+        // The cursor stops and resumes.
+        dlx_iter_t it = dlx_iter_new(dlx[1]);
+        int *row, n;
+        uint64_t h = 0;
+        while (dlx_iter_next(it, &row, &n)) {
+            F(i, n) h = h * 31 + row[i];
+            h++;
+        }
+        dlx_iter_free(it);
+        EXPECT(h == sols[0]);
+        F(b, 2) dlx_clear(dlx[b]);
+    }
+}
+
+void test_reduce() {
+    dlx_t dlx = dlx_new();
+    // Every row of column 0 has column 1, so row 1 goes, then row 2 is
+    // forced.
+    int rows[][3] = { {0, 1, -1}, {1, 2, -1}, {2, -1}, {0, 1, -1} };
+    F(r, 4) for (int *c = rows[r]; *c >= 0; c++) dlx_set(dlx, r, *c);
+    struct dlx_reduce_s st;
+    EXPECT(!dlx_reduce(dlx, &st));
+    EXPECT(st.forced == 1 && st.removed == 1 && st.merged == 1);
+    int sols = 0;
+    int f(int row[], int n) {
+        int set = 0;
+        F(i, n) set |= 1 << row[i];
+        EXPECT(set == 5 || set == 12);
+        sols += set;
+        return 0;
+    }
+    EXPECT(dlx_forall_cover_max(dlx, 0, f) == 2 && sols == 17);
+    EXPECT(dlx_count(dlx) == 2);
+    dlx_clear(dlx);
+
+    // A triangle has no exact cover.
+    dlx = dlx_new();
+    F(r, 3) dlx_set(dlx, r, r), dlx_set(dlx, r, (r + 1) % 3);
+    EXPECT(dlx_reduce(dlx, &st) == -1);
+    EXPECT(!dlx_count(dlx));
+    dlx_clear(dlx);
+
+    // Random instances with optional and colored columns: the same exact
+    // covers before and after, whichever way they are found.
+    srand(4);
+    F(iter, 300) {
+        int rows = 1 + rand() % 16, cols = 1 + rand() % 6;
+        int m[16][8] = {{0}};
+        dlx_t d[2];
+        F(r, rows) F(c, cols + 2) if (rand() % 3 == 0) {
+            m[r][c] = c < cols ? 1 : 1 + rand() % 3;
+        }
+        int removed = rand() % rows, picked = rand() % rows, how = rand() % 4;
+        int primary = 0;
+        F(c, cols) primary |= m[picked][c];
+        F(b, 2) {
+            d[b] = dlx_new();
+            F(r, rows) F(c, cols + 2) if (m[r][c]) {
+                if (c < cols || m[r][c] == 1) dlx_set(d[b], r, c);
+                else dlx_set_color(d[b], r, c, m[r][c]);
+            }
+            F(c, 2) dlx_mark_optional(d[b], cols + c);
+            if (how & 1) dlx_remove_row(d[b], removed);
+            if (how & 2 && primary && picked != removed) dlx_pick_row(d[b], picked);
+        }
+        int res = dlx_reduce(d[1], 0);
+        int sol[2][64], count[2] = { 0 };
+        F(b, 2) {
+            int f(int row[], int n) {
+                int set = 0;
+                F(i, n) set |= 1 << row[i];
+                if (count[b] < 64) sol[b][count[b]] = set;
+                count[b]++;
+                return 0;
+            }
+            dlx_forall_cover_max(d[b], 0, f);
+        }
+        EXPECT(count[0] == count[1]);
+        EXPECT(res == 0 || !count[0]);
+        int cmp(const void *x, const void *y) { return *(int *)x - *(int *)y; }
+        int n = count[0] < 64 ? count[0] : 64;
+        F(b, 2) qsort(sol[b], n, sizeof(int), cmp);
+        EXPECT(!memcmp(sol[0], sol[1], sizeof(int) * n));
+        EXPECT(dlx_count(d[1]) == (dlx_count_t)count[0]);
+        EXPECT(dlx_forall_cover_parallel(d[1], 2, 0) == count[0]);
+        // The ZDD and the cursor report the forced rows too.
+        int known(int row[], int n) {
+            int set = 0;
+            F(i, n) set |= 1 << row[i];
+            return count[0] > 64 || bsearch(&set, sol[0], count[0], sizeof(int), cmp);
+        }
+        int g(int row[], int n) {
+            EXPECT(known(row, n));
+            return 0;
+        }
+        dlx_zdd_t z = dlx_zdd_new(d[1]);
+        EXPECT(dlx_zdd_forall(z, g) == count[0]);
+        dlx_zdd_free(z);
+        dlx_iter_t it = dlx_iter_new(d[1]);
+        int *row, k = 0;
+        for (; dlx_iter_next(it, &row, &n); k++) EXPECT(known(row, n));
+        dlx_iter_free(it);
+        EXPECT(k == count[0]);
+        F(b, 2) dlx_clear(d[b]);
+    }
+}
+
+void test_symmetry() {
+    // Rows made of a few random sets of columns and all their rotations, so
+    // rotating every row is a symmetry. Declaring every rotation must leave
+    // one exact cover of each orbit, and declaring one must leave at least
+    // that and no more than every exact cover.
+    srand(5);
+    F(iter, 200) {
+        int n = 3 + rand() % 4, bases = 2 + rand() % 4, rows = n * bases;
+        int base[6][3], len[6];
+        F(b, bases) {
+            len[b] = 1 + rand() % 3;
+            F(k, len[b]) base[b][k] = rand() % n;
+        }
+        int rot(int r, int t) { return r / n * n + (r % n + t) % n; }
+        uint64_t image(uint64_t x, int t) {
+            uint64_t y = 0;
+            F(r, rows) if (x >> r & 1) y |= 1ull << rot(r, t);
+            return y;
+        }
+        // The same for every exact cover of an orbit.
+        uint64_t canon(uint64_t x) {
+            uint64_t m = x;
+            for (int t = 1; t < n; t++) if (image(x, t) < m) m = image(x, t);
+            return m;
+        }
+        uint64_t all[256], seen[256];
+        int count[3] = { 0 };
+        F(v, 3) {
+            dlx_t dlx = dlx_new();
+            F(b, bases) F(t, n) F(k, len[b]) dlx_set(dlx, b * n + t, (base[b][k] + t) % n);
+            if (iter % 4 == 1) dlx_set_row_order(dlx, DLX_ORDER_RANDOM, iter);
+            if (iter % 4 == 2) F(c, n) dlx_set_bounds(dlx, c, 1, 1);
+            int perm[36];
+            // No symmetry, every rotation, or just the first.
+            for (int t = 1; t < n && v; t++) {
+                F(r, rows) perm[r] = rot(r, t);
+                EXPECT(!dlx_add_symmetry(dlx, perm));
+                if (v == 2) break;
+            }
+            int f(int row[], int k) {
+                uint64_t x = 0;
+                F(i, k) x |= 1ull << row[i];
+                if (!v) {
+                    if (count[0] < 256) all[count[0]] = x;
+                } else if (v == 1 && count[1] < 256) {
+                    // No two from the same orbit.
+                    seen[count[1]] = canon(x);
+                    F(i, count[1]) EXPECT(seen[i] != seen[count[1]]);
+                }
+                count[v]++;
+                return 0;
+            }
+            if (iter % 4 == 3 && v) {
+                count[v] = dlx_forall_cover_parallel(dlx, 2, f);
+            } else {
+                dlx_forall_cover_max(dlx, 0, f);
+            }
+            dlx_clear(dlx);
+        }
+        if (count[0] > 256) continue;
+        int orbits = 0;
+        F(i, count[0]) orbits += all[i] == canon(all[i]);
+        EXPECT(count[1] == orbits);
+        EXPECT(count[2] >= orbits && count[2] <= count[0]);
+    }
+    // Not a permutation.
+    dlx_t dlx = dlx_new();
+    F(r, 3) dlx_set(dlx, r, r);
+    int perm[] = { 0, 0, 2 };
+    EXPECT(dlx_add_symmetry(dlx, perm) == -1);
+    dlx_clear(dlx);
+}
+
+void test_compile() {
+    // Sudoku puzzles made by blanking random cells of a solved grid, each
+    // solved on an instance stamped from one snapshot, by several threads at
+    // once, and on an instance built from scratch.
+    int nine(int a, int b, int c) { return ((a * 9) + b) * 9 + c; }
+    dlx_t build() {
+        dlx_t dlx = dlx_new();
+        F(n, 9) F(r, 9) F(c, 9) {
+            int row = nine(n, r, c);
+            dlx_set(dlx, row, nine(0, r, c));
+            dlx_set(dlx, row, nine(1, n, r));
+            dlx_set(dlx, row, nine(2, n, c));
+            dlx_set(dlx, row, nine(3, n, r / 3 * 3 + c / 3));
+        }
+        return dlx;
+    }
+    int sol[9][9], puzzle[64][9][9], want[64], got[64];
+    parse_sudoku(sol, sudoku17_1_solved);
+    srand(11);
+    F(i, 64) {
+        memcpy(puzzle[i], sol, sizeof(sol));
+        F(k, 30 + i) puzzle[i][rand() % 9][rand() % 9] = 0;
+    }
+    int count(dlx_t dlx, int grid[9][9]) {
+        F(r, 9) F(c, 9) if (grid[r][c]) dlx_pick_row(dlx, nine(grid[r][c] - 1, r, c));
+        return dlx_forall_cover_max(dlx, 50, 0);
+    }
+    dlx_t dlx = build();
+    dlx_compiled_t tmpl = dlx_compile(dlx);
+    F(i, 64) {
+        dlx_t fresh = build();
+        want[i] = count(fresh, puzzle[i]);
+        dlx_clear(fresh);
+    }
+    // The source can go, and the snapshot does not see later changes.
+    dlx_pick_row(dlx, 0);
+    dlx_clear(dlx);
+    int next = 0;
+    void *work(void *arg) {
+        for (int i; (i = __atomic_fetch_add(&next, 1, __ATOMIC_RELAXED)) < 64;) {
+            dlx_t state = dlx_state_new(tmpl);
+            got[i] = count(state, puzzle[i]);
+            dlx_clear(state);
+        }
+        return 0;
+    }
+    pthread_t th[4];
+    F(i, 4) pthread_create(th + i, 0, work, 0);
+    F(i, 4) pthread_join(th[i], 0);
+    F(i, 64) EXPECT(got[i] == want[i]);
+    EXPECT(want[0] == 1 && want[63] > 1);
+    // Picks, removals and reductions made before compiling carry over.
+    dlx = build();
+    dlx_pick_row(dlx, nine(0, 0, 0));
+    dlx_remove_row(dlx, nine(1, 0, 1));
+    dlx_reduce(dlx, 0);
+    dlx_compiled_free(tmpl);
+    tmpl = dlx_compile(dlx);
+    int a = dlx_forall_cover_max(dlx, 50, 0);
+    int first[81], n = 0;
+    int keep(int rows[], int k) {
+        if (!n) memcpy(first, rows, sizeof(int) * (n = k));
+        return 0;
+    }
+    dlx_forall_cover_max(dlx, 1, keep);
+    dlx_clear(dlx);
+    dlx_t state = dlx_state_new(tmpl);
+    dlx_compiled_free(tmpl);
+    EXPECT(a == dlx_forall_cover_max(state, 50, 0));
+    int same(int rows[], int k) {
+        EXPECT(k == n && !memcmp(rows, first, sizeof(int) * k));
+        return 0;
+    }
+    dlx_forall_cover_max(state, 1, same);
+    dlx_clear(state);
+}
+
+void test_push() {
+    // Random instances with optional, colored and sometimes bounded columns:
+    // after removals, picks and reductions, popping gives back the same
+    // exact covers in the same order.
+    srand(6);
+    F(iter, 300) {
+        int rows = 1 + rand() % 16, cols = 1 + rand() % 6;
+        int m[16][8] = {{0}};
+        dlx_t dlx = dlx_new();
+        F(r, rows) F(c, cols + 2) if (rand() % 3 == 0) {
+            m[r][c] = c < cols ? 1 : 1 + rand() % 3;
+            if (c < cols) dlx_set(dlx, r, c); else dlx_set_color(dlx, r, c, m[r][c]);
+        }
+        if (iter % 5 == 4) dlx_set_bounds(dlx, 0, 1, 2);
+        uint64_t sols[4][64];
+        int n[4];
+        void list(int k) {
+            n[k] = 0;
+            int f(int row[], int len) {
+                uint64_t x = 0;
+                F(i, len) x |= 1ull << row[i];
+                if (n[k] < 64) sols[k][n[k]] = x;
+                n[k]++;
+                return 0;
+            }
+            dlx_forall_cover_max(dlx, 0, f);
+        }
+        int same(int j, int k) {
+            return n[j] == n[k] && !memcmp(sols[j], sols[k], sizeof(uint64_t) * (n[j] < 64 ? n[j] : 64));
+        }
+        // Picks rows that share no column with those picked so far.
+        int used = 0;
+        void pick_some() {
+            F(t, 2) {
+                int r = rand() % rows, cover = 0;
+                F(c, cols + 2) if (m[r][c]) cover |= 1 << c;
+                if (cover & used) continue;
+                used |= cover;
+                dlx_pick_row(dlx, r);
+            }
+        }
+        list(0);
+        dlx_push(dlx);
+        dlx_remove_row(dlx, rand() % rows);
+        pick_some();
+        list(1);
+        dlx_push(dlx);
+        pick_some();
+        if (rand() % 2) dlx_reduce(dlx, 0);
+        list(2);
+        EXPECT(!dlx_pop(dlx));
+        list(3);
+        EXPECT(same(1, 3));
+        EXPECT(!dlx_pop(dlx));
+        list(3);
+        EXPECT(same(0, 3));
+        EXPECT(dlx_pop(dlx) == -1);
+        dlx_clear(dlx);
+    }
+    // Picking a row that clashes with an earlier pick, or removing a row
+    // picked or clashing with one, fails and leaves the instance alone.
+    dlx_t dlx = dlx_new();
+    dlx_add_row(dlx, (int[]){0, 1}, 2);
+    dlx_add_row(dlx, (int[]){1, 2}, 2);
+    dlx_add_row(dlx, (int[]){2}, 1);
+    dlx_add_row(dlx, (int[]){2, 3}, 2);
+    dlx_add_row(dlx, (int[]){3}, 1);
+    dlx_push(dlx);
+    EXPECT(!dlx_pick_row(dlx, 0));
+    EXPECT(-1 == dlx_pick_row(dlx, 1));
+    EXPECT(!dlx_pick_row(dlx, 3));
+    EXPECT(-1 == dlx_pick_row(dlx, 2));
+    EXPECT(-1 == dlx_remove_row(dlx, 0));
+    EXPECT(-1 == dlx_remove_row(dlx, 2));
+    EXPECT(1 == dlx_forall_cover_max(dlx, 0, 0));
+    EXPECT(!dlx_pop(dlx));
+    EXPECT(2 == dlx_forall_cover_max(dlx, 0, 0));
+    dlx_clear(dlx);
+}
+
+void test_add_row() {
+    // Random rows, with repeated columns, added whole or a cell at a time:
+    // the same exact covers in the same order.
+    srand(7);
+    F(iter, 200) {
+        int rows = 1 + rand() % 16, cols = 1 + rand() % 8;
+        int m[16][12], len[16];
+        dlx_t d[2] = { dlx_new(), dlx_new() };
+        if (iter % 2) dlx_reserve(d[1], rows, cols, rows * 12);
+        F(r, rows) {
+            len[r] = rand() % 12;
+            F(k, len[r]) m[r][k] = rand() % cols;
+            F(k, len[r]) dlx_set(d[0], r, m[r][k]);
+            EXPECT(dlx_add_row(d[1], m[r], len[r]) == r);
+        }
+        // Empty rows at the end exist only in the second.
+        while (rows && !len[rows - 1]) rows--;
+        EXPECT(dlx_rows(d[0]) == rows);
+        EXPECT(dlx_cols(d[0]) == dlx_cols(d[1]));
+        int sols[2][64], n[2] = { 0 };
+        F(b, 2) {
+            int f(int row[], int k) {
+                int set = 0;
+                F(i, k) set |= 1 << row[i];
+                if (n[b] < 64) sols[b][n[b]] = set;
+                n[b]++;
+                return 0;
+            }
+            dlx_forall_cover_max(d[b], 0, f);
+        }
+        EXPECT(n[0] == n[1]);
+        EXPECT(!memcmp(sols[0], sols[1], sizeof(int) * (n[0] < 64 ? n[0] : 64)));
+        F(b, 2) dlx_clear(d[b]);
+    }
+}
+
+void test_save() {
+    // Random instances with optional, colored and sometimes bounded columns,
+    // and a removed row: the same exact covers in the same order once saved
+    // and loaded, and the same labels.
+    char path[] = "/tmp/dlx_test_XXXXXX";
+    close(mkstemp(path));
+    srand(8);
+    F(iter, 200) {
+        int rows = 1 + rand() % 16, cols = 1 + rand() % 6;
+        dlx_t d[2] = { dlx_new() };
+        F(r, rows) F(c, cols + 2) if (rand() % 3 == 0) {
+            if (c < cols || rand() % 2) dlx_set(d[0], r, c);
+            else dlx_set_color(d[0], r, c, 1 + rand() % 3);
+        }
+        dlx_mark_optional(d[0], cols);
+        if (iter % 5 == 4) dlx_set_bounds(d[0], 0, 1, 2);
+        dlx_remove_row(d[0], rand() % rows);
+        rows = dlx_rows(d[0]);
+        char buf[16][8];
+        const char *label[16];
+        F(r, rows) sprintf(buf[r], "r%d", r), label[r] = r % 3 ? buf[r] : 0;
+        char **got;
+        EXPECT(!dlx_save(d[0], path, iter % 2 ? label : 0));
+        d[1] = dlx_load(path, &got);
+        EXPECT(d[1]);
+        EXPECT(dlx_rows(d[1]) == rows && dlx_cols(d[1]) == dlx_cols(d[0]));
+        if (iter % 2) {
+            F(r, rows) EXPECT(!strcmp(got[r], label[r] ? label[r] : ""));
+        } else {
+            EXPECT(!got);
+        }
+        free(got);
+        int sols[2][64], n[2] = { 0 };
+        F(b, 2) {
+            int f(int row[], int k) {
+                int set = 0;
+                F(i, k) set |= 1 << row[i];
+                if (n[b] < 64) sols[b][n[b]] = set;
+                n[b]++;
+                return 0;
+            }
+            dlx_forall_cover_max(d[b], 0, f);
+        }
+        EXPECT(n[0] == n[1]);
+        EXPECT(!memcmp(sols[0], sols[1], sizeof(int) * (n[0] < 64 ? n[0] : 64)));
+        F(b, 2) dlx_clear(d[b]);
+    }
+    // Bounds below 0 or the wrong way round.
+    dlx_t dlx = dlx_new();
+    dlx_set(dlx, 0, 0);
+    dlx_set_bounds(dlx, 0, 1, 2);
+    F(k, 2) {
+        EXPECT(!dlx_save(dlx, path, 0));
+        // The header, 2 row offsets, 1 column and 1 optional flag come first.
+        FILE *fp = fopen(path, "r+b");
+        int32_t lo = k ? -1 : 3;
+        EXPECT(!fseek(fp, 32 + 8 + 4 + 4, SEEK_SET) && fwrite(&lo, sizeof(lo), 1, fp) == 1);
+        fclose(fp);
+        EXPECT(!dlx_load(path, 0));
+    }
+    dlx_clear(dlx);
+    // A truncated file, and none at all.
+    EXPECT(!truncate(path, 40));
+    EXPECT(!dlx_load(path, 0));
+    unlink(path);
+    EXPECT(!dlx_load(path, 0));
+}
+
+void test_stats() {
+    // All permutations of 6 characters: level k branches 6 - k ways.
+    dlx_t dlx = dlx_new();
+    struct dlx_stats_s st;
+    EXPECT(-1 == dlx_get_stats(dlx, &st));
+    F(i, 6) F(j, 6) dlx_add_row(dlx, (int[]){i, 6 + j}, 2);
+    dlx_set_stats(dlx, 1);
+    long long want[7] = {1, 6, 30, 120, 360, 720, 720};
+    void check() {
+        EXPECT(!dlx_get_stats(dlx, &st));
+        EXPECT(st.nodes == 1957);
+        EXPECT(st.solutions == 720);
+        EXPECT(st.stuck == 0);
+        EXPECT(st.mems == -1 || st.mems > 0);
+        EXPECT(st.depth == 7);
+        F(d, 7) EXPECT(st.nodes_at[d] == want[d]);
+        F(d, 7) EXPECT(st.solutions_at[d] == (d == 6 ? 720 : 0));
+        F(k, DLX_STATS_BRANCH) EXPECT(st.branch[k] == (k && k <= 6 ? want[6 - k] : 0));
+        double sum = 0;
+        F(d, 7) sum += st.seconds_at[d];
+        EXPECT(sum >= 0 && st.seconds >= 0);
+    }
+    F(b, 3) {
+        dlx_set_backend(dlx, (int[]){DLX_LINKS, DLX_CELLS, DLX_BITS}[b]);
+        EXPECT(720 == dlx_forall_cover_max(dlx, 0, 0));
+        check();
+    }
+    EXPECT(720 == dlx_forall_cover_parallel(dlx, 3, 0));
+    check();
+    // With every row of column 6 gone, the root is a dead end.
+    F(i, 6) dlx_remove_row(dlx, 6 * i);
+    EXPECT(0 == dlx_forall_cover_max(dlx, 0, 0));
+    EXPECT(!dlx_get_stats(dlx, &st));
+    EXPECT(st.nodes == 1 && st.stuck == 1 && st.branch[0] == 1);
+    dlx_set_stats(dlx, 0);
+    EXPECT(-1 == dlx_get_stats(dlx, &st));
+    dlx_clear(dlx);
+}
+
+void test_estimate() {
+    // Every dive into the permutations of 6 sees the whole tree.
+    dlx_t dlx = dlx_new();
+    F(i, 6) F(j, 6) dlx_add_row(dlx, (int[]){i, 6 + j}, 2);
+    struct dlx_estimate_s est;
+    EXPECT(!dlx_estimate(dlx, 10, 1, &est));
+    EXPECT(est.nodes == 1957 && est.solutions == 720);
+    // Progress goes up steadily from 0 towards 1, on every backend.
+    double last;
+    int calls;
+    void progress(double done, long long nodes) {
+        EXPECT(done >= last && done < 1);
+        EXPECT(nodes == 100 * ++calls);
+        last = done;
+    }
+    dlx_set_progress(dlx, 100, progress);
+    F(b, 3) {
+        dlx_set_backend(dlx, (int[]){DLX_LINKS, DLX_CELLS, DLX_BITS}[b]);
+        last = calls = 0;
+        EXPECT(720 == dlx_forall_cover_max(dlx, 0, 0));
+        EXPECT(calls == 19 && last > 0.95);
+    }
+    dlx_clear(dlx);
+
+    // The 92 ways to place 8 queens, diagonals optional: a lopsided tree.
+    dlx = dlx_new();
+    F(r, 8) F(c, 8) dlx_add_row(dlx, (int[]){r, 8 + c, 16 + r + c, 31 + 7 + r - c}, 4);
+    F(i, 30) dlx_mark_optional(dlx, 16 + i);
+    struct dlx_stats_s st;
+    dlx_set_stats(dlx, 1);
+    EXPECT(92 == dlx_forall_cover_max(dlx, 0, 0));
+    EXPECT(!dlx_get_stats(dlx, &st));
+    EXPECT(!dlx_estimate(dlx, 100000, 1, &est));
+    EXPECT(fabs(est.nodes / st.nodes - 1) < 0.05);
+    EXPECT(fabs(est.solutions / 92 - 1) < 0.1);
+    dlx_set_bounds(dlx, 0, 1, 2);
+    EXPECT(-1 == dlx_estimate(dlx, 1, 1, &est));
+    dlx_clear(dlx);
+}
+
+void test_random() {
+    // All permutations of 6 characters.
+    dlx_t dlx = dlx_new();
+    F(i, 6) F(j, 6) dlx_add_row(dlx, (int[]){i, 6 + j}, 2);
+    int sol[3][6], k = 0;
+    void f(int r[], int n) {
+        EXPECT(n == 6);
+        int used = 0;
+        F(i, n) used |= 1 << r[i] / 6 | 1 << (6 + r[i] % 6);
+        EXPECT(used == 07777);
+        memset(sol[k], 0, sizeof(*sol));
+        F(i, n) sol[k][r[i] / 6] = r[i] % 6;
+        k++;
+    }
+    // The same seed, the same solution. Different seeds, different ones.
+    EXPECT(1 == dlx_solve_random(dlx, 1, 0, 0, f));
+    EXPECT(1 == dlx_solve_random(dlx, 1, 0, 0, f));
+    EXPECT(1 == dlx_solve_random(dlx, 2, 0, 0, f));
+    EXPECT(!memcmp(sol[0], sol[1], sizeof(*sol)));
+    EXPECT(memcmp(sol[0], sol[2], sizeof(*sol)));
+    // The links are back as they were.
+    EXPECT(720 == dlx_forall_cover_max(dlx, 0, 0));
+    dlx_clear(dlx);
+
+    // 7 pigeons, 6 holes: no exact cover, found out with no budget, and with
+    // restarts after every few nodes, never.
+    dlx = dlx_new();
+    F(i, 7) F(j, 6) dlx_add_row(dlx, (int[]){i, 7 + j}, 2);
+    F(j, 6) dlx_mark_optional(dlx, 7 + j);
+    // Statistics add up over the runs.
+    dlx_set_stats(dlx, 1);
+    struct dlx_stats_s st;
+    EXPECT(-1 == dlx_solve_random(dlx, 1, 4, 1000, f));
+    EXPECT(!dlx_get_stats(dlx, &st));
+    EXPECT(st.nodes >= 1000 && !st.solutions);
+    dlx_set_stats(dlx, 0);
+    EXPECT(0 == dlx_solve_random(dlx, 1, 0, 0, f));
+    EXPECT(k == 3);
+    EXPECT(0 == dlx_forall_cover_max(dlx, 0, 0));
+    dlx_clear(dlx);
+
+    // Restarts still get there on a sudoku.
+    dlx = dlx_new();
+    F(d, 9) F(r, 9) F(c, 9) {
+        dlx_add_row(dlx, (int[]){9*r + c, 81 + 9*r + d, 162 + 9*c + d, 243 + 9*(r/3*3 + c/3) + d}, 4);
+    }
+    F(i, 81) if (sudoku17_1[i] != '.') dlx_pick_row(dlx, 81*(sudoku17_1[i] - '1') + i);
+    int found = 0;
+    void g(int r[], int n) {
+        F(i, n) found += sudoku17_1_solved[r[i] % 81] == '1' + r[i] / 81;
+    }
+    dlx_set_stats(dlx, 1);
+    EXPECT(1 == dlx_solve_random(dlx, 7, 10, 0, g));
+    EXPECT(found == 81 - 17);
+    EXPECT(!dlx_get_stats(dlx, &st));
+    EXPECT(st.nodes > 0 && st.solutions == 1 && st.solutions_at[81 - 17] == 1);
+    dlx_clear(dlx);
+}
+
+void test_split() {
+    // All permutations of 6 characters.
+    dlx_t dlx = dlx_new();
+    F(i, 6) F(j, 6) dlx_add_row(dlx, (int[]){i, 6 + j}, 2);
+    // Every job puts its rows in each of its solutions.
+    int job[6], jobn, bad = 0;
+    int f(int r[], int n) {
+        EXPECT(n == 6);
+        F(i, jobn) {
+            int in = 0;
+            F(j, n) in |= r[j] == job[i];
+            bad += !in;
+        }
+        return 0;
+    }
+    char path[64];
+    // Depth 2 cuts the tree into 6 * 5 jobs of 4! solutions.
+    EXPECT(30 == dlx_split(dlx, 2, 0, "/tmp/dlx_test_job."));
+    int total = 0;
+    F(i, 30) {
+        sprintf(path, "/tmp/dlx_test_job.%d", i);
+        FILE *fp = fopen(path, "r");
+        EXPECT(fscanf(fp, "# dlx job %*d of %*d: %*d rows, %*d columns %d %d", job, job + 1) == 2);
+        fclose(fp);
+        jobn = 2;
+        dlx_push(dlx);
+        EXPECT(!dlx_pick_job(dlx, path));
+        int n = dlx_forall_cover_max(dlx, 0, f);
+        EXPECT(n == 24);
+        total += n;
+        dlx_pop(dlx);
+    }
+    EXPECT(total == 720);
+    EXPECT(!bad);
+    // Asking for 100 jobs cuts at depth 3, for 120.
+    EXPECT(120 == dlx_split(dlx, 0, 100, "/tmp/dlx_test_job."));
+    // A job for another instance, or with clashing rows, is refused.
+    dlx_t other = dlx_new();
+    F(i, 5) F(j, 5) dlx_add_row(other, (int[]){i, 5 + j}, 2);
+    EXPECT(-1 == dlx_pick_job(other, "/tmp/dlx_test_job.0"));
+    dlx_clear(other);
+    FILE *fp = fopen("/tmp/dlx_test_job.0", "w");
+    fprintf(fp, "# dlx job 0 of 1: 36 rows, 12 columns\n0 1\n");
+    fclose(fp);
+    EXPECT(-1 == dlx_pick_job(dlx, "/tmp/dlx_test_job.0"));
+    EXPECT(-1 == dlx_pick_job(dlx, "/tmp/no/such/job"));
+    EXPECT(720 == dlx_forall_cover_max(dlx, 0, 0));
+    F(i, 120) {
+        sprintf(path, "/tmp/dlx_test_job.%d", i);
+        remove(path);
+    }
+    dlx_clear(dlx);
+
+    // Solutions above the cut are jobs too: the row covering everything
+    // becomes a job by itself.
+    dlx = dlx_new();
+    dlx_add_row(dlx, (int[]){0, 1, 2, 3}, 4);
+    F(i, 4) dlx_add_row(dlx, (int[]){i}, 1);
+    dlx_add_row(dlx, (int[]){0, 1}, 2);
+    dlx_add_row(dlx, (int[]){2, 3}, 2);
+    int all = dlx_forall_cover_max(dlx, 0, 0), n = dlx_split(dlx, 3, 0, "/tmp/dlx_test_job.");
+    EXPECT(all == 5);
+    total = 0;
+    jobn = 0;
+    F(i, n) {
+        sprintf(path, "/tmp/dlx_test_job.%d", i);
+        dlx_push(dlx);
+        EXPECT(!dlx_pick_job(dlx, path));
+        total += dlx_forall_cover_max(dlx, 0, 0);
+        dlx_pop(dlx);
+        remove(path);
+    }
+    EXPECT(total == all);
+    dlx_clear(dlx);
+
+    // Under symmetries, the jobs still add up, though a job has fewer live
+    // rows to choose the order of comparison from: reversing the
+    // permutations leaves 720 / 2 of them.
+    dlx = dlx_new();
+    F(i, 6) F(j, 6) dlx_add_row(dlx, (int[]){i, 6 + j}, 2);
+    int perm[36];
+    F(i, 6) F(j, 6) perm[6*i + j] = 6*(5 - i) + j;
+    dlx_add_symmetry(dlx, perm);
+    EXPECT(360 == dlx_forall_cover_max(dlx, 0, 0));
+    n = dlx_split(dlx, 2, 0, "/tmp/dlx_test_job.");
+    total = 0;
+    F(i, n) {
+        sprintf(path, "/tmp/dlx_test_job.%d", i);
+        dlx_push(dlx);
+        EXPECT(!dlx_pick_job(dlx, path));
+        total += dlx_forall_cover_max(dlx, 0, 0);
+        dlx_pop(dlx);
+        remove(path);
+    }
+    EXPECT(total == 360);
+    EXPECT(360 == dlx_forall_cover_max(dlx, 0, 0));
+    dlx_clear(dlx);
+}
+
+void test_checkpoint() {
+    const char *path = "/tmp/dlx_test_ckpt", *mid = "/tmp/dlx_test_ckpt.mid";
+    // A permutation of 6 characters as a number in base 6.
+    int code(int r[], int n) {
+        int s[6], x = 0;
+        F(i, n) s[r[i] / 6] = r[i] % 6;
+        F(i, 6) x = 6 * x + s[i];
+        return x;
+    }
+    int all[720], alln, got[720], gotn;
+    int f(int r[], int n) {
+        all[alln++] = code(r, n);
+        // Keep a checkpoint from the middle of the search.
+        if (alln == 500) EXPECT(!rename(path, mid));
+        return 0;
+    }
+    int g(int r[], int n) {
+        got[gotn++] = code(r, n);
+        return 0;
+    }
+    // Checkpoints on links resume on bitsets, and the other way round.
+    F(b, 2) {
+        dlx_t dlx = dlx_new();
+        dlx_set_backend(dlx, b ? DLX_BITS : DLX_LINKS);
+        F(i, 6) F(j, 6) dlx_add_row(dlx, (int[]){i, 6 + j}, 2);
+        dlx_set_checkpoint(dlx, path, 100);
+        alln = 0;
+        EXPECT(720 == dlx_forall_cover_max(dlx, 0, f));
+        // The search finished, so there is nothing left.
+        EXPECT(720 == dlx_resume(dlx, path));
+        EXPECT(0 == dlx_forall_cover_max(dlx, 0, g));
+        // From the middle, the rest arrive in the same order, each once.
+        dlx_set_backend(dlx, b ? DLX_LINKS : DLX_BITS);
+        long long k = dlx_resume(dlx, mid);
+        EXPECT(k > 450 && k <= 500);
+        gotn = 0;
+        EXPECT(720 - k == dlx_forall_cover_max(dlx, 0, g));
+        EXPECT(!memcmp(got, all + k, sizeof(int) * gotn));
+        // A search that stops early resumes after its last solution.
+        remove(path);
+        gotn = 0;
+        EXPECT(300 == dlx_forall_cover_max(dlx, 300, g));
+        EXPECT(300 == dlx_resume(dlx, path));
+        EXPECT(420 == dlx_forall_cover_max(dlx, 0, g));
+        EXPECT(!memcmp(got, all, sizeof(all)));
+        // The links are back as they were.
+        dlx_set_checkpoint(dlx, NULL, 0);
+        EXPECT(720 == dlx_forall_cover_max(dlx, 0, 0));
+        dlx_clear(dlx);
+    }
+
+    // With symmetries, and rows tried least constraining first.
+    dlx_t dlx = dlx_new();
+    F(i, 6) F(j, 6) dlx_add_row(dlx, (int[]){i, 6 + j}, 2);
+    int perm[36];
+    F(i, 6) F(j, 6) perm[6*i + j] = 6*(5 - i) + j;
+    dlx_add_symmetry(dlx, perm);
+    dlx_set_row_order(dlx, DLX_ORDER_LEAST_CONSTRAINING, 0);
+    dlx_set_checkpoint(dlx, path, 10);
+    alln = gotn = 0;
+    EXPECT(100 == dlx_forall_cover_max(dlx, 100, g));
+    EXPECT(100 == dlx_resume(dlx, path));
+    EXPECT(260 == dlx_forall_cover_max(dlx, 0, g));
+    F(i, 360) F(j, i) EXPECT(got[i] != got[j]);
+    // A checkpoint of another instance is refused.
+    dlx_t other = dlx_new();
+    F(i, 5) F(j, 5) dlx_add_row(other, (int[]){i, 5 + j}, 2);
+    EXPECT(-1 == dlx_resume(other, path));
+    EXPECT(-1 == dlx_resume(other, "/tmp/no/such/checkpoint"));
+    dlx_clear(other);
+    dlx_clear(dlx);
+    remove(path);
+    remove(mid);
+}
+
+void test_batch() {
+    // All permutations of 6 characters, each as a number in base 6.
+    dlx_t dlx = dlx_new();
+    F(i, 6) F(j, 6) dlx_add_row(dlx, (int[]){i, 6 + j}, 2);
+    int code(int r[], int n) {
+        int s[6], x = 0;
+        F(i, n) s[r[i] / 6] = r[i] % 6;
+        F(i, 6) x = 6 * x + s[i];
+        return x;
+    }
+    int all[720], alln = 0;
+    int f(int r[], int n) {
+        all[alln++] = code(r, n);
+        return 0;
+    }
+    EXPECT(720 == dlx_forall_cover_max(dlx, 0, f));
+
+    // Batches arrive in the usual order, as full as they can be.
+    int off[101], rows[100], got[720], gotn = 0, batches = 0, stop_at = 0;
+    int g(struct dlx_batch_s *b) {
+        F(i, b->n) {
+            EXPECT(b->off[i + 1] - b->off[i] == 6);
+            got[gotn++] = code(b->rows + b->off[i], 6);
+        }
+        return ++batches == stop_at;
+    }
+    struct dlx_batch_s b = { .off = off, .rows = rows, .cap = 7, .rows_cap = 100 };
+    EXPECT(720 == dlx_forall_cover_batch(dlx, &b, g));
+    EXPECT(!memcmp(got, all, sizeof(all)));
+    EXPECT(batches == 103);
+    // Room for 20 rows takes 3 solutions at a time.
+    b = (struct dlx_batch_s) { .off = off, .rows = rows, .cap = 100, .rows_cap = 20 };
+    gotn = batches = 0;
+    EXPECT(720 == dlx_forall_cover_batch(dlx, &b, g));
+    EXPECT(!memcmp(got, all, sizeof(all)));
+    EXPECT(batches == 240);
+    // Stopping after the third batch.
+    gotn = batches = 0;
+    stop_at = 3;
+    EXPECT(9 == dlx_forall_cover_batch(dlx, &b, g));
+    EXPECT(gotn == 9);
+    stop_at = 0;
+    // A solution that cannot fit.
+    b.rows_cap = 5;
+    EXPECT(-1 == dlx_forall_cover_batch(dlx, &b, g));
+    b.rows_cap = 20;
+    b.cap = 0;
+    EXPECT(-1 == dlx_forall_cover_batch(dlx, &b, g));
+    b.cap = 100;
+    EXPECT(720 == dlx_forall_cover_max(dlx, 0, 0));
+
+    // In parallel, the same solutions in some order.
+    int cmp(const void *x, const void *y) { return *(int *)x - *(int *)y; }
+    F(threads, 4) {
+        gotn = batches = 0;
+        EXPECT(720 == dlx_forall_cover_parallel_batch(dlx, threads + 1, 16, 96, g));
+        qsort(got, 720, sizeof(int), cmp);
+        int sorted[720];
+        memcpy(sorted, all, sizeof(all));
+        qsort(sorted, 720, sizeof(int), cmp);
+        EXPECT(!memcmp(got, sorted, sizeof(all)));
+    }
+    gotn = batches = 0;
+    stop_at = 1;
+    long n = dlx_forall_cover_parallel_batch(dlx, 4, 16, 96, g);
+    EXPECT(n == gotn && n > 0 && n <= 16);
+    EXPECT(-1 == dlx_forall_cover_parallel_batch(dlx, 4, 16, 5, g));
+    EXPECT(-1 == dlx_forall_cover_parallel_batch(dlx, 4, 0, 96, g));
+    stop_at = 0;
+
+    // Checkpoints wait for the batch: stopping after 2 batches of 50 resumes
+    // after solution 100.
+    const char *path = "/tmp/dlx_test_batch_ckpt";
+    remove(path);
+    dlx_set_checkpoint(dlx, path, 1);
+    int big[300];
+    b = (struct dlx_batch_s) { .off = off, .rows = big, .cap = 50, .rows_cap = 300 };
+    gotn = batches = 0;
+    stop_at = 2;
+    EXPECT(100 == dlx_forall_cover_batch(dlx, &b, g));
+    stop_at = 0;
+    EXPECT(100 == dlx_resume(dlx, path));
+    EXPECT(620 == dlx_forall_cover_batch(dlx, &b, g));
+    EXPECT(!memcmp(got, all, sizeof(all)));
+    remove(path);
+    dlx_clear(dlx);
+
+    // Solutions of different lengths.
+    dlx = dlx_new();
+    dlx_add_row(dlx, (int[]){0, 1, 2, 3}, 4);
+    F(i, 4) dlx_add_row(dlx, (int[]){i}, 1);
+    dlx_add_row(dlx, (int[]){0, 1}, 2);
+    dlx_add_row(dlx, (int[]){2, 3}, 2);
+    int total = 0;
+    int h(struct dlx_batch_s *b) {
+        EXPECT(b->off[b->n] <= 4);
+        total += b->n;
+        return 0;
+    }
+    b = (struct dlx_batch_s) { .off = off, .rows = rows, .cap = 2, .rows_cap = 4 };
+    EXPECT(5 == dlx_forall_cover_batch(dlx, &b, h));
+    EXPECT(total == 5);
+    // No room is an error even with no exact cover to put there.
+    dlx_t none = dlx_new();
+    dlx_add_row(none, (int[]){0, 1}, 2);
+    dlx_add_row(none, (int[]){1, 2}, 2);
+    b.cap = 0;
+    EXPECT(-1 == dlx_forall_cover_batch(none, &b, h));
+    b.cap = 2;
+    EXPECT(0 == dlx_forall_cover_batch(none, &b, h));
+    dlx_clear(none);
+    // Stopping on the batch handed over early, to make room for the solution
+    // of 4 rows, resumes at that solution.
+    remove(path);
+    dlx_set_checkpoint(dlx, path, 1);
+    total = 0;
+    int k(struct dlx_batch_s *b) {
+        total += b->n;
+        return 1;
+    }
+    EXPECT(1 == dlx_forall_cover_batch(dlx, &b, k));
+    EXPECT(1 == dlx_resume(dlx, path));
+    EXPECT(4 == dlx_forall_cover_batch(dlx, &b, h));
+    EXPECT(total == 5);
+    remove(path);
+    dlx_clear(dlx);
+}
+
 int main() {
     test_sudoku();
     test_sudoku_duplicate_constraints();
@@ -288,5 +1717,28 @@ int main() {
     test_counter();
     test_perm();
     test_readme_example();
+    test_max();
+    test_iter();
+    test_deep();
+    test_parallel();
+    test_zdd();
+    test_choice();
+    test_row_order();
+    test_color();
+    test_bounds();
+    test_backend();
+    test_bits();
+    test_reduce();
+    test_symmetry();
+    test_compile();
+    test_push();
+    test_add_row();
+    test_save();
+    test_stats();
+    test_estimate();
+    test_random();
+    test_split();
+    test_checkpoint();
+    test_batch();
     return 0;
 }
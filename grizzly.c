@@ -2,6 +2,15 @@
 //
 // Solves logic grid puzzles. By default, uses the DLX agorithm, but
 // uses brute force if --alg=brute is given on the command-line.
+// With --max=N, the DLX algorithms stop after N solutions; --max=2 is enough
+// to tell whether a puzzle has a unique solution. With --reduce, they first
+// strip the DLX-rows no solution can use and pick those every solution needs,
+// reporting the counts on stderr. With --dump-matrix=FILE, they save the
+// DLX-table they build, and with --load-matrix=FILE, they read it back
+// instead of building it; the puzzle must be given all the same. With
+// --stats, they print statistics of the search on stderr as JSON. With
+// --random=SEED, they print one solution found by a randomized search with
+// restarts, seeded by SEED.
 //
 // We view a logic grid puzzle as follows. Given a MxN table of distinct
 // symbols and some constraints, for each row except the first, we are to
@@ -66,6 +75,49 @@ struct hint_s {
 };
 typedef struct hint_s *hint_ptr;
 
+// If positive, the DLX solvers stop after this many solutions.
+static int max_solutions;
+// Set to reduce the DLX-table before searching it.
+static int reduce;
+// Files to save the DLX-table to, or to read it from instead of building it.
+static const char *dump_matrix, *load_matrix;
+// Set to print statistics of the search.
+static int stats;
+// Set to look for one solution at random, from the seed.
+static int randomize;
+static unsigned long long seed;
+
+static dlx_t matrix_load(char ***labels) {
+    dlx_t dlx = dlx_load(load_matrix, labels);
+    if (!dlx) die("%s: cannot load matrix", load_matrix);
+    return dlx;
+}
+
+static void matrix_dump(dlx_t dlx, const char *const labels[]) {
+    if (dlx_save(dlx, dump_matrix, labels)) die("%s: cannot save matrix", dump_matrix);
+}
+
+static void dlx_search(dlx_t dlx, int (*f)(int[], int)) {
+    if (reduce) {
+        struct dlx_reduce_s st;
+        if (dlx_reduce(dlx, &st)) fprintf(stderr, "reduce: no solution\n");
+        fprintf(stderr, "reduce: %d forced, %d removed, %d merged\n",
+                st.forced, st.removed, st.merged);
+    }
+    dlx_set_stats(dlx, stats);
+    if (randomize) {
+        void g(int rows[], int n) { f(rows, n); }
+        dlx_solve_random(dlx, seed, 100, 0, g);
+    } else {
+        dlx_forall_cover_max(dlx, max_solutions, f);
+    }
+    struct dlx_stats_s st;
+    if (!dlx_get_stats(dlx, &st)) {
+        dlx_print_stats(stderr, &st);
+        fputc('\n', stderr);
+    }
+}
+
 // Solves using brute force.
 void brute(int M, int N, char *sym[M][N], int hint_n, hint_ptr *hint) {
     // For each row except the first, generate all permutations.
@@ -158,7 +210,7 @@ void brute(int M, int N, char *sym[M][N], int hint_n, hint_ptr *hint) {
 // Solves using DLX where each possible column corresponds to a subset in
 // the collection.
 void per_col_dlx(int M, int N, char *sym[M][N], int hint_n, hint_ptr *hint) {
-    dlx_t dlx = dlx_new();
+    dlx_t dlx = load_matrix ? 0 : dlx_new();
     // Generate all possible columns: an M-digit counter in base N.
     // Columns that pass initial checks become the DLX-rows.
     int a[M];  // Holds current column.
@@ -169,6 +221,10 @@ void per_col_dlx(int M, int N, char *sym[M][N], int hint_n, hint_ptr *hint) {
     // The array dlx_a records the columns that pass the initial checks and
     // hence added as a DLX-row.
     int dlx_max = 32, (*dlx_a)[M] = NEW_ARRAY(dlx_a, dlx_max);
+    // Bounds the 1s in a DLX-row: one per symbol, and per hint, at most one
+    // per DLX-column, with one repeat, or one per pair of symbols.
+    int most = M;
+    F(i, hint_n) most += N + 1 + hint[i]->n;
     void f(int i) {
         int has(hint_ptr h, int i) { return a[h->coord[i][0]] == h->coord[i][1]; }
         int match(hint_ptr h) {
@@ -199,8 +255,15 @@ void per_col_dlx(int M, int N, char *sym[M][N], int hint_n, hint_ptr *hint) {
             // Add a new DLX-row to represent it.
             GROW(dlx_a, dlxM, dlx_max);
             F(i, M) dlx_a[dlxM][i] = a[i];
+            // The row's DLX-columns, added at once when complete, then its
+            // colored ones.
+            int col[most], coln = 0, tint[hint_n + 1][2], tintn = 0;
+            void set(int c) { col[coln++] = c; }
+            void set_color(int c, int color) {
+                tint[tintn][0] = c, tint[tintn++][1] = color;
+            }
             // Set the DLX-column coresponding to each symbol.
-            F(k, M) dlx_set(dlx, dlxM, N*k + a[k]);
+            F(k, M) set(N*k + a[k]);
             // Add optional columns for constraints that need it.
             void assign_dlx_col(hint_ptr h) {
                 if (!h->dlx_col) {
@@ -211,15 +274,17 @@ void per_col_dlx(int M, int N, char *sym[M][N], int hint_n, hint_ptr *hint) {
             void opthints(hint_ptr h) {
                 switch(h->cmd) {
                     case '1':
-                        assign_dlx_col(h);
+                        // One column, colored by where the second symbol
+                        // must be, which the two rows must agree on.
+                        if (!h->dlx_col) {
+                            h->dlx_col = dlxN;
+                            dlx_mark_optional(dlx, dlxN++);
+                        }
                         if (has(h, 0)) {
-                            F(k, N) {
-                                if (k == a[0] + 1) continue;
-                                dlx_set(dlx, dlxM, h->dlx_col + k);
-                            }
+                            set_color(h->dlx_col, a[0] + 2);
                         }
                         if (has(h, 1)) {
-                            dlx_set(dlx, dlxM, h->dlx_col + a[0]);
+                            set_color(h->dlx_col, a[0] + 1);
                         }
                         break;
                     case 'A':
@@ -227,23 +292,23 @@ void per_col_dlx(int M, int N, char *sym[M][N], int hint_n, hint_ptr *hint) {
                         if (has(h, 0)) {
                             F(k, N) {
                                 if (abs(k - a[0]) == 1) continue;
-                                dlx_set(dlx, dlxM, h->dlx_col + k);
+                                set(h->dlx_col + k);
                             }
                         }
                         if (has(h, 1)) {
-                            dlx_set(dlx, dlxM, h->dlx_col + a[0]);
+                            set(h->dlx_col + a[0]);
                         }
                         break;
                     case '<':
                         assign_dlx_col(h);
                         if (has(h, 0)) {
                             for(int k = 0; k <= a[0]; k++) {
-                                dlx_set(dlx, dlxM, h->dlx_col + k);
+                                set(h->dlx_col + k);
                             }
                         }
                         if (has(h, 1)) {
                             for(int k = a[0]; k < N; k++) {
-                                dlx_set(dlx, dlxM, h->dlx_col + k);
+                                set(h->dlx_col + k);
                             }
                         }
                         break;
@@ -255,7 +320,7 @@ void per_col_dlx(int M, int N, char *sym[M][N], int hint_n, hint_ptr *hint) {
                         int count = 0;
                         F(k, h->n) count += has(h, k);
                         if (count >= 2) {
-                            dlx_set(dlx, dlxM, h->dlx_col);
+                            set(h->dlx_col);
                         }
                         break;
                     case 'X':
@@ -263,11 +328,13 @@ void per_col_dlx(int M, int N, char *sym[M][N], int hint_n, hint_ptr *hint) {
                             h->dlx_col = dlxN;
                             dlx_mark_optional(dlx, dlxN++);
                         }
-                        F(k, h->n/2) if (has(h, 2*k) && has(h, 2*k + 1)) dlx_set(dlx, dlxM, h->dlx_col);
+                        F(k, h->n/2) if (has(h, 2*k) && has(h, 2*k + 1)) set(h->dlx_col);
                         break;
                 }
             }
             F(i, hint_n) opthints(hint[i]);
+            dlx_add_row(dlx, col, coln);
+            F(i, tintn) dlx_set_color(dlx, dlxM, tint[i][0], tint[i][1]);
             dlxM++;
             return;
         }
@@ -276,10 +343,39 @@ void per_col_dlx(int M, int N, char *sym[M][N], int hint_n, hint_ptr *hint) {
             f(i+1);
         }
     }
-    f(0);
+    if (!load_matrix) {
+        f(0);
+    } else {
+        // Each DLX-row is labeled with its column.
+        char **label;
+        dlx = matrix_load(&label);
+        if (!label) die("%s: not saved by per_col_dlx", load_matrix);
+        dlxM = dlx_rows(dlx);
+        dlx_a = realloc(dlx_a, sizeof(*dlx_a) * (dlx_max = dlxM + 1));
+        F(r, dlxM) {
+            char *s = label[r];
+            F(i, M) {
+                dlx_a[r][i] = strtol(s, &s, 10);
+                if (dlx_a[r][i] < 0 || dlx_a[r][i] >= N) die("%s: bad label", load_matrix);
+            }
+        }
+        free(label);
+    }
+    if (dump_matrix) {
+        char (*text)[12 * M] = NEW_ARRAY(text, dlxM + 1);
+        const char **label = NEW_ARRAY(label, dlxM + 1);
+        F(r, dlxM) {
+            int k = 0;
+            F(i, M) k += sprintf(text[r] + k, i ? " %d" : "%d", dlx_a[r][i]);
+            label[r] = text[r];
+        }
+        matrix_dump(dlx, label);
+        free(label);
+        free(text);
+    }
 
     // Solve!
-    void pr(int row[], int n) {
+    int pr(int row[], int n) {
         F(i, n) {
             F(k, M) {
                 if (k) putchar(' ');
@@ -287,130 +383,149 @@ void per_col_dlx(int M, int N, char *sym[M][N], int hint_n, hint_ptr *hint) {
             }
             putchar('\n');
         }
+        return 0;
     }
-    dlx_forall_cover(dlx, pr);
+    dlx_search(dlx, pr);
     dlx_clear(dlx);
     free(dlx_a);
 }
 
 void per_cell_dlx(int M, int N, char *sym[M][N], int hint_n, hint_ptr *hint) {
-    dlx_t dlx = dlx_new();
-    // It's easier to add all rows then subtract forbidden rows at the end than
-    // to attempt a purely additive construction of the DLX-table.
-    int remove_me[(M-1)*N*N];
-
-    // DLX-rows: row (m*N + n)*N + k = sym[m+1][n] in the kth column.
-    F(m, M-1) F(n, N) F(k, N) {
-        int r = (m*N + n)*N + k;
-        // sym[m+1][n] must be used exactly once.
-        dlx_set(dlx, r, m*N + n);
-        // solution[m+1][k] must contain exactly one symbol.
-        dlx_set(dlx, r, (M-1)*N + m*N + k);
-        remove_me[r] = 0;
-    }
-
     // The first row of the puzzle is a special case, complicating our code.
+    // Clues placing a symbol beside one of it become picked DLX-rows, which
+    // a saved DLX-table does not hold.
     int sol[M-1][N];
     F(m, M-1) F(n, N) sol[m][n] = -1;
-    int base = 2*(M-1)*N;
-    F(i, hint_n) {
+    F(i, hint_n) if (hint[i]->cmd == '=') {
         hint_ptr h = hint[i];
-        int row_of(int x, int k) {
-            return ((h->coord[x][0] - 1)*N + h->coord[x][1])*N + k;
+        F(x, h->n) if (!h->coord[x][0]) {
+            F(y, h->n) if (x != y) {
+                sol[h->coord[y][0] - 1][h->coord[x][1]] = h->coord[y][1];
+            }
+            break;
         }
-        switch(h->cmd) {
-            case '=': {
-                int firstrow = 0;
-                F(x, h->n) if (!h->coord[x][0]) {
-                    F(y, h->n) if (x != y) {
-                        sol[h->coord[y][0] - 1][h->coord[x][1]] = h->coord[y][1];
-                    }
-                    firstrow = 1;
-                    break;
-                }
-                if (firstrow) break;
+    }
+    dlx_t build() {
+        dlx_t dlx = dlx_new();
+        // It's easier to add all rows then subtract forbidden rows at the end
+        // than to attempt a purely additive construction of the DLX-table.
+        int remove_me[(M-1)*N*N];
 
-                F(x, h->n) F(k, N) {
-                    dlx_set(dlx, row_of(x, k), base + k);
-                    F(y, h->n) if (x != y) F(n, N) if (n != k) {
-                        dlx_set(dlx, row_of(y, n), base + k);
-                    }
-                    F(k, N) dlx_mark_optional(dlx, base++);
-                }
-                break;
+        // DLX-rows: row (m*N + n)*N + k = sym[m+1][n] in the kth column.
+        F(m, M-1) F(n, N) F(k, N) {
+            int r = (m*N + n)*N + k;
+            // sym[m+1][n] must be used exactly once.
+            dlx_set(dlx, r, m*N + n);
+            // solution[m+1][k] must contain exactly one symbol.
+            dlx_set(dlx, r, (M-1)*N + m*N + k);
+            remove_me[r] = 0;
+        }
+
+        int base = 2*(M-1)*N;
+        F(i, hint_n) {
+            hint_ptr h = hint[i];
+            int row_of(int x, int k) {
+                return ((h->coord[x][0] - 1)*N + h->coord[x][1])*N + k;
             }
-            case '!':
-                F(x, h->n) {
-                    if (!h->coord[x][0]) {
-                        F(y, h->n) if (x != y && h->coord[y][0]) {
-                            remove_me[row_of(y, h->coord[x][1])] = 1;
-                        }
-                    } else F(k, N) {
+            switch(h->cmd) {
+                case '=': {
+                    int firstrow = 0;
+                    F(x, h->n) firstrow |= !h->coord[x][0];
+                    if (firstrow) break;
+
+                    F(x, h->n) F(k, N) {
                         dlx_set(dlx, row_of(x, k), base + k);
-                        F(y, h->n) if (x != y && h->coord[y][0]) {
-                            dlx_set(dlx, row_of(y, k), base + k);
+                        F(y, h->n) if (x != y) F(n, N) if (n != k) {
+                            dlx_set(dlx, row_of(y, n), base + k);
                         }
                         F(k, N) dlx_mark_optional(dlx, base++);
                     }
-                }
-                break;
-            case '<':
-                if (!h->coord[0][0]) {
-                    F(k, h->coord[0][1]+1) remove_me[row_of(1, k)] = 1;
                     break;
                 }
-                if (!h->coord[1][0]) {
-                    for (int k = h->coord[1][1]; k < N; k++) {
-                        remove_me[row_of(0, k)] = 1;
+                case '!':
+                    F(x, h->n) {
+                        if (!h->coord[x][0]) {
+                            F(y, h->n) if (x != y && h->coord[y][0]) {
+                                remove_me[row_of(y, h->coord[x][1])] = 1;
+                            }
+                        } else F(k, N) {
+                            dlx_set(dlx, row_of(x, k), base + k);
+                            F(y, h->n) if (x != y && h->coord[y][0]) {
+                                dlx_set(dlx, row_of(y, k), base + k);
+                            }
+                            F(k, N) dlx_mark_optional(dlx, base++);
+                        }
                     }
                     break;
-                }
-                F(k, N) {
-                    dlx_set(dlx, row_of(0, k), base + k);
-                    F(n, k+1) dlx_set(dlx, row_of(1, n), base + k);
-                }
-                F(k, N) dlx_mark_optional(dlx, base++);
-                break;
-            case '1': {
-                int x = !h->coord[1][0];
-                if (!h->coord[x][0]) {
-                    F(k, N) if (h->coord[x][1] - k != 1) remove_me[row_of(!x, k)] = 1; 
+                case '<':
+                    if (!h->coord[0][0]) {
+                        F(k, h->coord[0][1]+1) remove_me[row_of(1, k)] = 1;
+                        break;
+                    }
+                    if (!h->coord[1][0]) {
+                        for (int k = h->coord[1][1]; k < N; k++) {
+                            remove_me[row_of(0, k)] = 1;
+                        }
+                        break;
+                    }
+                    F(k, N) {
+                        dlx_set(dlx, row_of(0, k), base + k);
+                        F(n, k+1) dlx_set(dlx, row_of(1, n), base + k);
+                    }
+                    F(k, N) dlx_mark_optional(dlx, base++);
                     break;
-                }
-                F(k, N) {
-                    dlx_set(dlx, row_of(0, k), base + k);
-                    F(n, N) if (n - k != 1) dlx_set(dlx, row_of(1, n), base + k);
-                }
-                F(k, N) dlx_mark_optional(dlx, base++);
-                break;
-            }
-            case 'A': {
-                int x = !h->coord[1][0];
-                if (!h->coord[x][0]) {
-                    F(k, N) if (abs(h->coord[x][1] - k) != 1) remove_me[row_of(!x, k)] = 1; 
+                case '1': {
+                    int x = !h->coord[1][0];
+                    if (!h->coord[x][0]) {
+                        F(k, N) if (h->coord[x][1] - k != 1) remove_me[row_of(!x, k)] = 1; 
+                        break;
+                    }
+                    // One column, colored by where the second symbol must be.
+                    F(k, N) {
+                        dlx_set_color(dlx, row_of(0, k), base, k + 2);
+                        dlx_set_color(dlx, row_of(1, k), base, k + 1);
+                    }
+                    base++;
                     break;
                 }
-                F(k, N) {
-                    dlx_set(dlx, row_of(0, k), base + k);
-                    F(n, N) if (abs(n - k) != 1) dlx_set(dlx, row_of(1, n), base + k);
+                case 'A': {
+                    int x = !h->coord[1][0];
+                    if (!h->coord[x][0]) {
+                        F(k, N) if (abs(h->coord[x][1] - k) != 1) remove_me[row_of(!x, k)] = 1; 
+                        break;
+                    }
+                    F(k, N) {
+                        dlx_set(dlx, row_of(0, k), base + k);
+                        F(n, N) if (abs(n - k) != 1) dlx_set(dlx, row_of(1, n), base + k);
+                    }
+                    F(k, N) dlx_mark_optional(dlx, base++);
+                    break;
                 }
-                F(k, N) dlx_mark_optional(dlx, base++);
-                break;
             }
         }
+        F(r, (M-1)*N*N) if (remove_me[r]) dlx_remove_row(dlx, r);
+        return dlx;
+    }
+    dlx_t dlx;
+    if (load_matrix) {
+        dlx = matrix_load(0);
+        if (dlx_rows(dlx) > (M-1)*N*N) die("%s: not saved by per_cell_dlx", load_matrix);
+    } else {
+        dlx = build();
+        if (dump_matrix) matrix_dump(dlx, 0);
     }
-    F(r, (M-1)*N*N) if (remove_me[r]) dlx_remove_row(dlx, r);
     F(m, M-1) F(n, N) if (sol[m][n] >= 0) dlx_pick_row(dlx, (m*N + sol[m][n])*N + n);
     // Solve!
-    void f(int row[], int row_n) {
+    int f(int row[], int row_n) {
         F(i, row_n) sol[row[i]/N/N][row[i]%N] = row[i]/N%N;
         F(n, N) {
             printf("%s", sym[0][n]);
             F(m, M-1) printf(" %s", sym[m+1][sol[m][n]]);
             putchar('\n');
         }
+        return 0;
     }
-    dlx_forall_cover(dlx, f);
+    dlx_search(dlx, f);
     dlx_clear(dlx);
 }
 
@@ -420,6 +535,12 @@ int main(int argc, char *argv[]) {
     for (;;) {
         static struct option longopts[] = {
                 {"alg", required_argument, 0, 'a'},
+                {"max", required_argument, 0, 'm'},
+                {"reduce", no_argument, 0, 'r'},
+                {"dump-matrix", required_argument, 0, 'd'},
+                {"load-matrix", required_argument, 0, 'l'},
+                {"stats", no_argument, 0, 's'},
+                {"random", required_argument, 0, 'R'},
                 {0, 0, 0, 0},
         };
         int c = getopt_long(argc, argv, "", longopts, 0);
@@ -437,6 +558,25 @@ int main(int argc, char *argv[]) {
                     exit(0);
                 }
                 break;
+            case 'm':
+                max_solutions = atoi(optarg);
+                break;
+            case 'r':
+                reduce = 1;
+                break;
+            case 'd':
+                dump_matrix = optarg;
+                break;
+            case 'l':
+                load_matrix = optarg;
+                break;
+            case 's':
+                stats = 1;
+                break;
+            case 'R':
+                randomize = 1;
+                seed = strtoull(optarg, 0, 0);
+                break;
             case '?':
                 exit(0);
             default: die("unreachable!");
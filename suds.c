@@ -26,9 +26,27 @@
 //  4 7 . | . . 6 | . . .  
 //
 // Shows step-by-step reasoning when run with -v option.
+//
+// With -u, only checks whether the puzzle has exactly one solution, stopping
+// as soon as a second one turns up.
+//
+// With -r SEED, prints one solution found by a randomized search seeded by
+// SEED, with restarts. On an empty grid, this makes a random complete sudoku.
+//
+// With -b, reads puzzles until the end of input and prints one line for each:
+// its first solution as 81 digits, or with -u, the verdict. The sudoku matrix
+// is built once and compiled, and each thread solves its puzzles on a copy of
+// it, undoing the givens after each. -j sets the number of threads (0 = one
+// per processor).
+//
+// With --stats, prints statistics of each search on stderr as JSON, tagged
+// with the puzzle's number in batch mode.
 #include <ctype.h>
+#include <getopt.h>
+#include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <unistd.h>
 #include "dlx.h"
 
@@ -36,36 +54,144 @@
 #define C(i,n,dir) for(cell_t i = n->dir; i != n; i = i->dir)
 
 int main(int argc, char *argv[]) {
-    int verbose = 0, opt;
-    while ((opt = getopt(argc, argv, "v")) != -1) {
-        if (opt == 'v') verbose++; else {
-            fprintf(stderr, "Usage: %s [-v]\n", *argv);
+    int verbose = 0, unique = 0, batch = 0, nthreads = 1, stats = 0, randomize = 0, opt;
+    unsigned long long seed = 0;
+    static struct option longopts[] = {
+        {"stats", no_argument, 0, 's'},
+        {0, 0, 0, 0},
+    };
+    while ((opt = getopt_long(argc, argv, "bj:r:uv", longopts, 0)) != -1) {
+        if (opt == 'v') verbose++; else if (opt == 'u') unique++;
+        else if (opt == 'b') batch++; else if (opt == 'j') nthreads = atoi(optarg);
+        else if (opt == 's') stats++;
+        else if (opt == 'r') randomize++, seed = strtoull(optarg, 0, 0);
+        else {
+            fprintf(stderr, "Usage: %s [-buv] [-j threads] [-r seed] [--stats]\n", *argv);
             exit(1);
         }
     }
-    int a[9][9] = {{0}}, c;
-    F(i, 9) F(j, 9) do if (EOF == (c = getchar())) exit(1); while(
-            isdigit(c) ? a[i][j] = c - '0', 0 : c != '.');
+    // Prints the statistics of the last search of s, on puzzle i if i >= 0.
+    void report(dlx_t s, int i) {
+        struct dlx_stats_s st;
+        if (dlx_get_stats(s, &st)) return;
+        flockfile(stderr);
+        if (i >= 0) fprintf(stderr, "{\"puzzle\": %d, \"stats\": ", i);
+        dlx_print_stats(stderr, &st);
+        fputs(i >= 0 ? "}\n" : "\n", stderr);
+        funlockfile(stderr);
+    }
+    // Returns 0 if the input ends first.
+    int read_grid(int a[9][9]) {
+        int c;
+        F(i, 9) F(j, 9) do if (EOF == (c = getchar())) return 0; while(
+                isdigit(c) ? a[i][j] = c - '0', 0 : c != '.');
+        return 1;
+    }
 
     dlx_t dlx = dlx_new();
     int nine(int a, int b, int c) { return 9*9*a + 9*b + c; }
+    dlx_reserve(dlx, 9*9*9, 4*9*9, 4*9*9*9);
+    dlx_set_stats(dlx, stats);
+    // Row nine(d, r, c) puts digit d + 1 at row r, column c.
     F(d, 9) F(r, 9) F(c, 9) {
-        int i = 0;
-        void con(int x, int y) { dlx_set(dlx, nine(d, r, c), nine(i++, x, y)); }
-        con(r, c);            // One digit per cell.
-        con(r, d);            // One digit per row.
-        con(c, d);            // One digit per column.
-        con(r/3*3 + c/3, d);  // One digit per 3x3 region.
+        int col[4] = {
+            nine(0, r, c),              // One digit per cell.
+            nine(1, r, d),              // One digit per row.
+            nine(2, c, d),              // One digit per column.
+            nine(3, r/3*3 + c/3, d),    // One digit per 3x3 region.
+        };
+        dlx_add_row(dlx, col, 4);
     }
+
+    if (batch) {
+        int (*puzzle)[9][9] = 0, n = 0, alloc = 0;
+        for (;;) {
+            if (n == alloc) puzzle = realloc(puzzle, sizeof(*puzzle) * (alloc = 2*alloc + 64));
+            memset(puzzle[n], 0, sizeof(*puzzle));
+            if (!read_grid(puzzle[n])) break;
+            n++;
+        }
+        char (*out)[82] = malloc(sizeof(*out) * n);
+        dlx_compiled_t tmpl = dlx_compile(dlx);
+        dlx_clear(dlx);
+        int next = 0;
+        void *work(void *arg) {
+            dlx_t s = dlx_state_new(tmpl);
+            for (int i; (i = __atomic_fetch_add(&next, 1, __ATOMIC_RELAXED)) < n;) {
+                dlx_push(s);
+                // Givens that clash leave nothing to search.
+                int clash = 0;
+                F(r, 9) F(c, 9) if (puzzle[i][r][c] && !clash) {
+                    clash = dlx_pick_row(s, nine(puzzle[i][r][c]-1, r, c));
+                }
+                dlx_iter_t it = dlx_iter_new(s);
+                int *row, k, found = 0;
+                while (!clash && found < 1 + unique && dlx_iter_next(it, &row, &k)) {
+                    if (!found++) {
+                        memset(out[i], '0', 81);
+                        out[i][81] = 0;
+                        F(r, 9) F(c, 9) if (puzzle[i][r][c]) out[i][9*r + c] += puzzle[i][r][c];
+                        F(j, k) out[i][row[j]%81] = '1' + row[j]/81;
+                    }
+                }
+                dlx_iter_free(it);
+                report(s, i);
+                dlx_pop(s);
+                if (unique || !found) {
+                    strcpy(out[i], !found ? "no solution" : found == 1 ? "unique" : "multiple solutions");
+                }
+            }
+            dlx_clear(s);
+            return 0;
+        }
+        if (nthreads <= 0) nthreads = sysconf(_SC_NPROCESSORS_ONLN);
+        if (nthreads <= 0) nthreads = 1;
+        pthread_t th[nthreads];
+        F(i, nthreads) pthread_create(th + i, 0, work, 0);
+        F(i, nthreads) pthread_join(th[i], 0);
+        F(i, n) puts(out[i]);
+        dlx_compiled_free(tmpl);
+        free(out);
+        free(puzzle);
+        return 0;
+    }
+
+    int a[9][9] = {{0}};
+    if (!read_grid(a)) exit(1);
     // Fill in the given digits.
-    F(r, 9) F(c, 9) if (a[r][c]) dlx_pick_row(dlx, nine(a[r][c]-1, r, c));
+    F(r, 9) F(c, 9) if (a[r][c] && dlx_pick_row(dlx, nine(a[r][c]-1, r, c))) {
+        puts("no solution");
+        dlx_clear(dlx);
+        return 1;
+    }
+
+    if (unique) {
+        // Pull at most two solutions.
+        dlx_iter_t it = dlx_iter_new(dlx);
+        int *row, k, n = 0;
+        while (n < 2 && dlx_iter_next(it, &row, &k)) n++;
+        dlx_iter_free(it);
+        report(dlx, -1);
+        puts(n == 0 ? "no solution" : n == 1 ? "unique" : "multiple solutions");
+        dlx_clear(dlx);
+        return n != 1;
+    }
 
     // Print all solutions.
     void print_solution(int row[], int n) {
         F(i, n) a[row[i]/9%9][row[i]%9] = row[i]/9/9 + 1;
         F(r, 9) F(c, 9 || (putchar('\n'), 0)) putchar('0'+a[r][c]);
     }
+    if (randomize) {
+        // Restart every hundred nodes or so; a sudoku seldom needs more.
+        int found = dlx_solve_random(dlx, seed, 100, 0, print_solution);
+        report(dlx, -1);
+        if (!found) puts("no solution");
+        dlx_clear(dlx);
+        return !found;
+    }
     dlx_forall_cover(dlx, print_solution);
+    report(dlx, -1);
     if (verbose) {
         // Print reasoning.
         int kid[9*9], n = 0, tried[9*9] = { 0 }, indent = 0;
@@ -1,6 +1,8 @@
 #include <stdio.h>
 #include <string.h>
 #include <unistd.h>
+#include <getopt.h>
+#include <map>
 #include <vector>
 #include "tiles.h"
 #include "linereader.h"
@@ -110,12 +112,23 @@ public:
     typedef Cell::Coord Coord;
     enum Rotation { r0, r90, r180, r270, r0r, r90r, r180r, r270r };
     Soln(Coord width, Coord height)
-        : width_(width), height_(height), board_(width * height) {
-        for (unsigned i = 0; i < board_.size(); ++i)
+        : width_(width), height_(height), board_(width * height), piece_(width * height), shared_(false) {
+        for (unsigned i = 0; i < board_.size(); ++i) {
             board_[i] = '.';
+            piece_[i] = -1;
+        }
+    }
+    // Add a piece, returning its number. Pieces of the same kind are
+    // interchangeable when comparing solutions.
+    int add_piece(char kind) {
+        if (std::find(kinds_.begin(), kinds_.end(), kind) != kinds_.end())
+            shared_ = true;
+        kinds_.push_back(kind);
+        return kinds_.size() - 1;
     }
-    void set_cell(Coord x, Coord y, char ch) { 
+    void set_cell(Coord x, Coord y, char ch, int piece) { 
         board_[XY(x, y, width_)] = ch;
+        piece_[XY(x, y, width_)] = piece;
     }
     char cell(Coord x, Coord y) const {
         if (x >= width_ || y >= height_)
@@ -202,11 +215,35 @@ protected:
         auto rsize = rotref_dims(rot);
         if (rsize.x != width_ || rsize.y != height_)
             return false;
+        if (!shared_ && !s.shared_) {
+            // Every piece is drawn differently, so comparing cells will do.
+            for (Coord x = 0; x < width_; ++x) {
+                for (Coord y = 0; y < height_; ++y) {
+                    auto s_coords = rotref(x, y, rot);
+                    if (cell(x,y) != s.cell(s_coords.x, s_coords.y))
+                        return false;
+                }
+            }
+            return true;
+        }
+        // Otherwise match up the pieces of the two solutions one to one.
+        std::vector<int> map(kinds_.size(), -1), back(s.kinds_.size(), -1);
         for (Coord x = 0; x < width_; ++x) {
             for (Coord y = 0; y < height_; ++y) {
                 auto s_coords = rotref(x, y, rot);
-                if (cell(x,y) != s.cell(s_coords.x, s_coords.y))
+                int p = piece_[XY(x, y, width_)];
+                int q = s.piece_[XY(s_coords.x, s_coords.y, width_)];
+                if (p < 0 || q < 0) {
+                    if (p != q)
+                        return false;
+                } else if (map[p] < 0 && back[q] < 0) {
+                    if (kinds_[p] != s.kinds_[q])
+                        return false;
+                    map[p] = q;
+                    back[q] = p;
+                } else if (map[p] != q) {
                     return false;
+                }
             }
         }
         return true;
@@ -215,6 +252,9 @@ private:
     Coord width_;
     Coord height_;
     std::vector<char> board_;
+    std::vector<int> piece_;
+    std::vector<char> kinds_;
+    bool shared_; // Some kind has more than one piece.
 };
 
 // ----------------------------------------------------------------
@@ -222,17 +262,24 @@ class PrintInfo {
 public:
     typedef Cell::Coord Coord;
     struct TilePos {
-        TilePos(std::shared_ptr<Shape> orient, Coord x, Coord y, char vchar)
-            : orient(orient), vchar(vchar), x(x), y(y) {}
+        TilePos(std::shared_ptr<Shape> orient, Coord x, Coord y, int group, int orient_num)
+            : orient(orient), group(group), orient_num(orient_num), x(x), y(y) {}
         std::shared_ptr<Shape> orient;
-        char vchar;
+        int group;      // Identical tiles share a group and its dlx rows.
+        int orient_num; // Index of orient among the tile's orientations.
         Coord x;
         Coord y;
     };
+    // Names and display characters of the orientations of one tile.
+    struct TileCopy {
+        std::vector<std::string> names;
+        std::vector<char> vchars;
+    };
     PrintInfo() {}
     void init(Coord width, Coord height, VisType vis, VisParam const& vis_param, bool rotref, unsigned print_num) {
         soln_list_.clear();
         tile_pos_list_.clear();
+        group_list_.clear();
         total_ = 0;
         width_ = width;
         height_ = height;
@@ -243,21 +290,43 @@ public:
         rotref_ = rotref;
         print_num_ = print_num;
     }
-    void add_tile(std::shared_ptr<Shape> orient, Coord x, Coord y, char tile_char) {
-        tile_pos_list_.push_back(PrintInfo::TilePos(orient, x, y, tile_char));
+    void add_copy(size_t group, std::list<std::shared_ptr<Shape> > const& orients, char tile_char, bool print_rev_name) {
+        if (group_list_.size() <= group)
+            group_list_.resize(group+1);
+        TileCopy copy;
+        for (auto orient : orients) {
+            copy.names.push_back(orient->name());
+            copy.vchars.push_back(print_rev_name ? orient->name()[0] : tile_char);
+        }
+        group_list_[group].push_back(copy);
+    }
+    void add_tile(std::shared_ptr<Shape> orient, Coord x, Coord y, int group, int orient_num) {
+        tile_pos_list_.push_back(PrintInfo::TilePos(orient, x, y, group, orient_num));
     }
     unsigned total() const { return total_; }
-    void print_soln(int row[], int n) {
+    // Returns true once enough solutions have been printed.
+    bool print_soln(int row[], int n) {
+        // Hand out the copies of each group to its rows in row order,
+        // so a solution is always drawn the same way.
+        std::vector<int> order(n), copy(n);
+        for (int i = 0; i < n; ++i)
+            order[i] = i;
+        std::sort(order.begin(), order.end(), [&](int a, int b) { return row[a] < row[b]; });
+        std::vector<int> used(group_list_.size());
+        for (int i : order)
+            copy[i] = used[tile_pos_list_[row[i]].group]++;
         Soln soln(width_, height_);
         for (int i = 0; i < n; ++i) {
             PrintInfo::TilePos tp = tile_pos_list_[row[i]];
+            char vchar = group_list_[tp.group][copy[i]].vchars[tp.orient_num];
+            int piece = soln.add_piece(group_list_[tp.group][0].vchars[tp.orient_num]);
             for (auto cell : *tp.orient)
-                soln.set_cell(tp.x + cell.x(), tp.y + cell.y(), tp.vchar);
+                soln.set_cell(tp.x + cell.x(), tp.y + cell.y(), vchar, piece);
         }
         if (!rotref_) {
             for (auto s2 : soln_list_)
                 if (soln.is_equiv(s2))
-                    return;
+                    return false;
         }
         soln_list_.push_back(soln);
         switch (vis_) {
@@ -265,7 +334,8 @@ public:
             soln.draw_indent(vis_param_.indent);
             for (int i = 0; i < n; ++i) {
                 PrintInfo::TilePos tp = tile_pos_list_[row[i]];
-                printf("%-*s(%*d,%*d) ", sp_name_, tp.orient->name().c_str(),
+                std::string const& name = group_list_[tp.group][copy[i]].names[tp.orient_num];
+                printf("%-*s(%*d,%*d) ", sp_name_, name.c_str(),
                     sp_coord_, tp.x, sp_coord_, tp.y);
             }
             printf("\n");
@@ -279,13 +349,11 @@ public:
         default: break;
         }
         total_++;
-        if (print_num_ > 0 && total_ >= print_num_) {
-            // Ugh. There's no way to tell dlx to stop.
-            exit(0);
-        }
+        return print_num_ > 0 && total_ >= print_num_;
     }
 private:
     std::vector<TilePos> tile_pos_list_;
+    std::vector<std::vector<TileCopy> > group_list_;
     std::vector<Soln> soln_list_;
     Coord width_;
     Coord height_;
@@ -301,31 +369,29 @@ private:
 static PrintInfo PI;
 
 // ----------------------------------------------------------------
-static bool create_dlx_row(dlx_t dlx, int dlx_row, Board const& board, Cell::Coord px, Cell::Coord py, int tile_num, std::shared_ptr<Shape> orient)
+static bool create_dlx_row(dlx_t dlx, Board const& board, Cell::Coord px, Cell::Coord py, int tile_num, std::shared_ptr<Shape> orient)
 {
     // Each row of the dlx matrix looks like:
     //   CCCC...CCCC TTTT...TTTT
     // where the first group has one bit for each cell in the board, and
-    // the second group has one bit for each tile (eg. 12 bits for pentominos).
-    // Thus the entire row contains (board.size() + tiles.size()) bits.
+    // the second group has one bit for each distinct tile (eg. 12 bits for
+    // pentominos). Thus the entire row contains (board.size() + groups) bits.
     // The row represents a tile in a specific position and orientation.
     // Bits in the first group indicate which board cells are covered by the tile.
     // Exactly one bit will be set in the second group, to indicate the tile.
 
     // Make a list of the dlx columns that should be set.
     // Don't actually set them until we're sure we are going to use this dlx row.
-    std::list<int> dlx_cols;
+    std::vector<int> dlx_cols(1, board.size() + tile_num); // tile indicator
     for (auto cell : *orient) {
         int dlx_col = board.dlx_column(px+cell.x(), py+cell.y());
         if (dlx_col < 0) // tile doesn't fit here; skip this px,py
             return false;
-        dlx_cols.push_back(dlx_col);
+        dlx_cols.push_back(dlx_col); // one cell covered by this tile
     }
-    if (dlx_cols.empty())
+    if (dlx_cols.size() == 1)
         return false;
-    dlx_set(dlx, dlx_row, board.size() + tile_num); // tile indicator
-    for (int dlx_col : dlx_cols)
-        dlx_set(dlx, dlx_row, dlx_col); // one cell covered by this tile
+    dlx_add_row(dlx, dlx_cols.data(), dlx_cols.size());
     return true;
 }
 
@@ -339,22 +405,160 @@ static size_t all_tiles_size(Tile::Set const& tiles)
 }
 
 // ----------------------------------------------------------------
-static void print_soln(int row[], int n)
+static int print_soln(int row[], int n)
+{
+    return PI.print_soln(row, n);
+}
+
+// ----------------------------------------------------------------
+// Pull solutions until PrintInfo has printed as many as it wants.
+static void print_solns_iter(dlx_t dlx)
+{
+    dlx_iter_t it = dlx_iter_new(dlx);
+    int* row;
+    int n;
+    while (dlx_iter_next(it, &row, &n))
+        if (PI.print_soln(row, n))
+            break;
+    dlx_iter_free(it);
+}
+
+// ----------------------------------------------------------------
+// A dlx row as a tile number and the sorted dlx columns of the cells it covers.
+typedef std::pair<int, std::vector<int> > Placement;
+
+static Placement placement(Board const& board, Cell::Coord px, Cell::Coord py, int tile_num, std::shared_ptr<Shape> orient)
+{
+    Placement p(tile_num, std::vector<int>());
+    for (auto cell : *orient)
+        p.second.push_back(board.dlx_column(px+cell.x(), py+cell.y()));
+    std::sort(p.second.begin(), p.second.end());
+    return p;
+}
+
+// ----------------------------------------------------------------
+// Declare each rotation and reflection of the board that maps every dlx row
+// to another, so the search only finds one solution of each set of
+// equivalent ones instead of leaving them all for PrintInfo to weed out.
+static void add_symmetries(dlx_t dlx, Board const& board, std::vector<Placement> const& rows)
 {
-    PI.print_soln(row, n);
+    std::map<Placement, int> index;
+    for (size_t i = 0; i < rows.size(); ++i)
+        index[rows[i]] = i;
+    std::vector<Cell> where(board.cbegin(), board.cend());
+    Cell::Coord w = board.width(), h = board.height();
+    for (int rot = 1; rot < 8; ++rot) {
+        // Where the cell at dlx column col goes, as in Soln::rotref, or -1.
+        auto map_col = [&](int col) {
+            Cell::Coord x = where[col].x(), y = where[col].y();
+            Cell::Coord xm = w-x-1, ym = h-y-1;
+            Cell::Coord to[8][2] = { {x, y}, {ym, x}, {xm, ym}, {y, xm},
+                                     {x, ym}, {y, x}, {xm, y}, {ym, xm} };
+            if (to[rot][0] >= w || to[rot][1] >= h)
+                return -1;
+            return board.dlx_column(to[rot][0], to[rot][1]);
+        };
+        std::vector<int> perm;
+        for (auto const& row : rows) {
+            Placement image(row.first, std::vector<int>());
+            for (int col : row.second)
+                image.second.push_back(map_col(col));
+            std::sort(image.second.begin(), image.second.end());
+            auto it = index.find(image);
+            if (it == index.end())
+                break;
+            perm.push_back(it->second);
+        }
+        if (perm.size() == rows.size())
+            dlx_add_symmetry(dlx, perm.data());
+    }
 }
 
 // ----------------------------------------------------------------
-static dlx_t create_dlx_matrix(Board const& board, Tile::Set const& tiles, bool print_rev_name, bool rev) {
+// Files to save the dlx matrix to, or to read it from instead of building it.
+static std::string dump_matrix;
+static std::string load_matrix;
+// Set to print statistics of the search on stderr.
+static bool print_stats;
+// Set to report the progress of the search on stderr.
+static bool print_progress;
+// A job file from --split, to solve just that part of the search.
+static std::string job_file;
+// Where to checkpoint the search, resuming from it if it is there.
+static std::string checkpoint_file;
+
+static dlx_t create_dlx_matrix(Board const& board, Tile::Set const& tiles, bool print_rev_name, bool rev, bool symmetric) {
+    // Identical tiles share one tile indicator column, which must be covered
+    // once per copy, so the search never tries swapping them around.
+    std::vector<std::shared_ptr<Tile> > groups;
+    std::vector<int> copies;
+    for (auto tile : tiles) {
+        size_t group = 0;
+        while (group < groups.size() &&
+                !(*groups[group] == *tile && groups[group]->parity() == tile->parity()))
+            ++group;
+        if (group == groups.size()) {
+            groups.push_back(tile);
+            copies.push_back(0);
+        }
+        ++copies[group];
+        PI.add_copy(group, tile->all_orientations(rev), tile->name()[0], print_rev_name);
+    }
+
+    std::vector<Placement> rows;
+    if (!load_matrix.empty()) {
+        // Each dlx row is labeled with its placement.
+        char **label;
+        dlx_t dlx = dlx_load(load_matrix.c_str(), &label);
+        if (dlx == NULL || label == NULL) {
+            printf("error: cannot load matrix %s\n", load_matrix.c_str());
+            if (dlx != NULL)
+                dlx_clear(dlx);
+            return NULL;
+        }
+        if (dlx_cols(dlx) != (int)(groups.size() + std::distance(board.cbegin(), board.cend()))) {
+            printf("error: matrix %s does not match the tiles\n", load_matrix.c_str());
+            free(label);
+            dlx_clear(dlx);
+            return NULL;
+        }
+        std::vector<std::vector<std::shared_ptr<Shape> > > orients;
+        for (auto tile : groups) {
+            auto list = tile->all_orientations(rev);
+            orients.push_back(std::vector<std::shared_ptr<Shape> >(list.begin(), list.end()));
+        }
+        for (int r = 0; r < dlx_rows(dlx); ++r) {
+            int tile_num, orient_num, px, py;
+            if (sscanf(label[r], "%d %d %d %d", &tile_num, &orient_num, &px, &py) != 4 ||
+                    tile_num < 0 || tile_num >= (int)orients.size() ||
+                    orient_num < 0 || orient_num >= (int)orients[tile_num].size()) {
+                printf("error: matrix %s does not match the tiles\n", load_matrix.c_str());
+                free(label);
+                dlx_clear(dlx);
+                return NULL;
+            }
+            auto orient = orients[tile_num][orient_num];
+            PI.add_tile(orient, px, py, tile_num, orient_num);
+            if (symmetric)
+                rows.push_back(placement(board, px, py, tile_num, orient));
+        }
+        free(label);
+        if (symmetric)
+            add_symmetries(dlx, board, rows);
+        return dlx;
+    }
+
     // Create the dlx matrix.
     dlx_t dlx = dlx_new();
-    int dlx_row = 0;
     int tile_num = 0;
-    for (auto tile : tiles) {
+    std::vector<std::string> labels;
+    for (auto tile : groups) {
         bool tile_fits = false;
         int parity = tile->parity();
         auto orients = tile->all_orientations(rev);
+        int orient_num = -1;
         for (auto orient : orients) {
+            ++orient_num;
             // Place tile shape at every possible px,py on board
             // and make a dlx row for each such position.
             if (orient->height() > board.height() || orient->width() > board.width())
@@ -363,10 +567,15 @@ static dlx_t create_dlx_matrix(Board const& board, Tile::Set const& tiles, bool
             for (Cell::Coord py = 0; py <= board.height() - orient->height(); ++py)
             for (Cell::Coord px = 0; px <= board.width() - orient->width(); ++px) {
                 if (parity < 0 || (int)((px+py) % Tile::num_parity) == parity) {
-                    if (create_dlx_row(dlx, dlx_row, board, px, py, tile_num, orient)) {
-                        char tile_char = print_rev_name ? orient->name()[0] : tile->name()[0];
-                        PI.add_tile(orient, px, py, tile_char);
-                        ++dlx_row;
+                    if (create_dlx_row(dlx, board, px, py, tile_num, orient)) {
+                        PI.add_tile(orient, px, py, tile_num, orient_num);
+                        if (!dump_matrix.empty()) {
+                            char label[64];
+                            snprintf(label, sizeof(label), "%d %d %d %d", tile_num, orient_num, (int)px, (int)py);
+                            labels.push_back(label);
+                        }
+                        if (symmetric)
+                            rows.push_back(placement(board, px, py, tile_num, orient));
                     }
                 }
             }
@@ -375,13 +584,24 @@ static dlx_t create_dlx_matrix(Board const& board, Tile::Set const& tiles, bool
             printf("error: board is too narrow to fit tile %s\n", tile->name().c_str());
             return NULL;
         }
+        if (copies[tile_num] > 1)
+            dlx_set_bounds(dlx, board.size() + tile_num, copies[tile_num], copies[tile_num]);
         ++tile_num;
     }
+    if (!dump_matrix.empty()) {
+        std::vector<const char*> label;
+        for (auto const& l : labels)
+            label.push_back(l.c_str());
+        if (dlx_save(dlx, dump_matrix.c_str(), label.data()) != 0)
+            printf("error: cannot save matrix %s\n", dump_matrix.c_str());
+    }
+    if (symmetric)
+        add_symmetries(dlx, board, rows);
     return dlx;
 }
 
 // ----------------------------------------------------------------
-int print_solns(Board const& board, Tile::Set const& tiles, VisType vis, VisParam const& vis_param, bool print_rev_name, bool rotref, unsigned print_num, bool rev)
+int print_solns(Board const& board, Tile::Set const& tiles, VisType vis, VisParam const& vis_param, bool print_rev_name, bool rotref, unsigned print_num, bool rev, int threads, bool reduce)
 {
     if (all_tiles_size(tiles) != board.size()) {
         // Area of tiles is different from area of board; they will never fit.
@@ -392,12 +612,139 @@ int print_solns(Board const& board, Tile::Set const& tiles, VisType vis, VisPara
 
     // Set up PrintInfo for print_soln.
     PI.init(board.width(), board.height(), vis, vis_param, rotref, print_num);
-    dlx_t dlx = create_dlx_matrix(board, tiles, print_rev_name, rev);
+    dlx_t dlx = create_dlx_matrix(board, tiles, print_rev_name, rev, !rotref);
+    if (dlx == NULL)
+        return 0;
+    if (reduce)
+        dlx_reduce(dlx, NULL);
+    if (!job_file.empty() && dlx_pick_job(dlx, job_file.c_str()) != 0) {
+        printf("error: %s is not a job for this puzzle\n", job_file.c_str());
+        dlx_clear(dlx);
+        return 0;
+    }
+    long long resumed = 0;
+    if (!checkpoint_file.empty()) {
+        if (threads != 1) {
+            printf("error: cannot checkpoint a search on several threads\n");
+            dlx_clear(dlx);
+            return 0;
+        }
+        FILE* f = fopen(checkpoint_file.c_str(), "r");
+        if (f != NULL) {
+            fclose(f);
+            resumed = dlx_resume(dlx, checkpoint_file.c_str());
+            if (resumed < 0) {
+                printf("error: %s is not a checkpoint of this search\n", checkpoint_file.c_str());
+                dlx_clear(dlx);
+                return 0;
+            }
+            fprintf(stderr, "resuming after %lld solutions\n", resumed);
+        }
+        dlx_set_checkpoint(dlx, checkpoint_file.c_str(), 1 << 22);
+    }
 
     // Run the dlx solver.
-    dlx_forall_cover(dlx, print_soln);
+    dlx_set_stats(dlx, print_stats);
+    if (print_progress) {
+        dlx_set_progress(dlx, 1 << 20, [](double done, long long nodes) {
+            fprintf(stderr, "progress: %.2f%% of the tree, %lld nodes\n", 100 * done, nodes);
+        });
+    }
+    if (threads == 1)
+        print_solns_iter(dlx);
+    else
+        dlx_forall_cover_parallel(dlx, threads, print_soln);
+    struct dlx_stats_s stats;
+    if (dlx_get_stats(dlx, &stats) == 0) {
+        dlx_print_stats(stderr, &stats);
+        fputc('\n', stderr);
+    }
+    dlx_clear(dlx);
+    return PI.total() + resumed;
+}
+
+// ----------------------------------------------------------------
+// Count solutions with the memoized search, without enumerating them.
+// Rotations and reflections are counted as distinct.
+static bool count_solns(Board const& board, Tile::Set const& tiles, bool rev, bool reduce)
+{
+    if (all_tiles_size(tiles) != board.size()) {
+        printf("error: tiles cover %d squares but board is %d squares\n",
+            (int) all_tiles_size(tiles), (int) board.size());
+        return false;
+    }
+    PI.init(board.width(), board.height(), VisType::NONE, VisParam(), true, 0);
+    dlx_t dlx = create_dlx_matrix(board, tiles, false, rev, false);
+    if (dlx == NULL)
+        return false;
+    if (reduce)
+        dlx_reduce(dlx, NULL);
+    dlx_zdd_t zdd = dlx_zdd_new(dlx);
+    char buf[40];
+    if (zdd == NULL) {
+        // Identical tiles give bounded columns, which the memoized search
+        // does not handle; fall back to enumerating.
+        printf("%s solutions\n", dlx_count_str(dlx_count(dlx), buf));
+    } else {
+        printf("%s solutions (%d ZDD nodes)\n", dlx_count_str(dlx_zdd_count(zdd), buf), dlx_zdd_size(zdd));
+        dlx_zdd_free(zdd);
+    }
+    dlx_clear(dlx);
+    return true;
+}
+
+// ----------------------------------------------------------------
+// Estimate the size of the search print_solns would run, from random probes.
+static bool estimate_solns(Board const& board, Tile::Set const& tiles, bool rev, bool rotref, bool reduce, int samples)
+{
+    if (all_tiles_size(tiles) != board.size()) {
+        printf("error: tiles cover %d squares but board is %d squares\n",
+            (int) all_tiles_size(tiles), (int) board.size());
+        return false;
+    }
+    PI.init(board.width(), board.height(), VisType::NONE, VisParam(), rotref, 0);
+    dlx_t dlx = create_dlx_matrix(board, tiles, false, rev, !rotref);
+    if (dlx == NULL)
+        return false;
+    if (reduce)
+        dlx_reduce(dlx, NULL);
+    struct dlx_estimate_s est;
+    if (dlx_estimate(dlx, samples, 1, &est) != 0) {
+        // Identical tiles give bounded columns, which the estimate does not
+        // handle.
+        printf("error: cannot estimate a search with identical tiles\n");
+        dlx_clear(dlx);
+        return false;
+    }
+    printf("about %.3g nodes and %.3g solutions (%d samples)\n", est.nodes, est.solutions, samples);
+    dlx_clear(dlx);
+    return true;
+}
+
+// ----------------------------------------------------------------
+// Split the search print_solns would run into at least count jobs, written
+// to files job.0, job.1, ... in the current directory.
+static bool split_solns(Board const& board, Tile::Set const& tiles, bool rev, bool rotref, bool reduce, int count)
+{
+    if (all_tiles_size(tiles) != board.size()) {
+        printf("error: tiles cover %d squares but board is %d squares\n",
+            (int) all_tiles_size(tiles), (int) board.size());
+        return false;
+    }
+    PI.init(board.width(), board.height(), VisType::NONE, VisParam(), rotref, 0);
+    dlx_t dlx = create_dlx_matrix(board, tiles, false, rev, !rotref);
+    if (dlx == NULL)
+        return false;
+    if (reduce)
+        dlx_reduce(dlx, NULL);
+    int n = dlx_split(dlx, 0, count, "job.");
     dlx_clear(dlx);
-    return PI.total();
+    if (n < 0) {
+        printf("error: cannot split a search with identical tiles, or write the jobs\n");
+        return false;
+    }
+    printf("%d jobs\n", n);
+    return true;
 }
 
 // ----------------------------------------------------------------
@@ -413,16 +760,42 @@ int main(int argc, char* argv[])
     bool print_count = true;
     bool rev = true;
     unsigned print_num = 0;
+    int threads = 1;
+    bool count_only = false;
+    bool reduce = false;
+    int estimate = 0;
+    int split = 0;
 
     if (argc > 1 && (strcmp(argv[1], "help") == 0 || strcmp(argv[1], "--help") == 0))
         return print_help();
 
+    static struct option longopts[] = {
+        { "dump-matrix", required_argument, NULL, 'D' },
+        { "load-matrix", required_argument, NULL, 'L' },
+        { "stats", no_argument, NULL, 'S' },
+        { "estimate", required_argument, NULL, 'E' },
+        { "progress", no_argument, NULL, 'P' },
+        { "split", required_argument, NULL, 'J' },
+        { "job", required_argument, NULL, 'F' },
+        { "checkpoint", required_argument, NULL, 'C' },
+        { NULL, 0, NULL, 0 },
+    };
     int opt;
-    while ((opt = getopt(argc, argv, "1chi:ln:prRst:uvVW:x?")) != -1) {
+    while ((opt = getopt_long(argc, argv, "1cehi:j:ln:prRst:uvVW:xz?", longopts, NULL)) != -1) {
         switch (opt) {
+        case 'D': dump_matrix = optarg; break;
+        case 'L': load_matrix = optarg; break;
+        case 'S': print_stats = true; break;
+        case 'E': estimate = atoi(optarg); break;
+        case 'P': print_progress = true; break;
+        case 'J': split = atoi(optarg); break;
+        case 'F': job_file = optarg; break;
+        case 'C': checkpoint_file = optarg; break;
         case '1': print_num = 1; break;
         case 'c': print_count = false; break;
+        case 'e': reduce = true; break;
         case 'i': vis_param.indent = atoi(optarg); break;
+        case 'j': threads = atoi(optarg); break;
         case 'l': vis = VisType::DESC; break;
         case 'n': print_num = atoi(optarg); break;
         case 'p': tile_desc = tiles_pentominos; break;
@@ -435,6 +808,7 @@ int main(int argc, char* argv[])
         case 'V': vis = VisType::ART; break;
         case 'W': if (sscanf(optarg, "%u,%u", &vis_param.art_hchars, &vis_param.art_vrows) != 2) return usage(); break;
         case 'x': tile_desc = tiles_hexominos; break;
+        case 'z': count_only = true; break;
         case 'h': case '?': return print_help();
         default: return usage();
         }
@@ -464,7 +838,13 @@ int main(int argc, char* argv[])
         return 1;
     }
 
-    int n = print_solns(*board.get(), tiles, vis, vis_param, print_rev_name, rotref, print_num, rev);
+    if (count_only)
+        return count_solns(*board.get(), tiles, rev, reduce) ? 0 : 1;
+    if (estimate > 0)
+        return estimate_solns(*board.get(), tiles, rev, rotref, reduce, estimate) ? 0 : 1;
+    if (split > 0)
+        return split_solns(*board.get(), tiles, rev, rotref, reduce, split) ? 0 : 1;
+    int n = print_solns(*board.get(), tiles, vis, vis_param, print_rev_name, rotref, print_num, rev, threads, reduce);
     if (print_count)
         printf("%d solutions\n", n);
     return 0;
@@ -1,19 +1,44 @@
 char help1[] = {
 
-"usage: tiles [-vVl] [-crsu1][-n#][-i#][-W#,#] [-p][-x][-t TILES] BOARD\n"
+"usage: tiles [-vVl] [-cersuz1][-n#][-i#][-j#][-W#,#] [-p][-x][-t TILES]\n"
+"             [--dump-matrix FILE][--load-matrix FILE][--stats]\n"
+"             [--estimate N][--progress][--split N | --job FILE]\n"
+"             [--checkpoint FILE] BOARD\n"
 "       -v = print ASCII picture for each solution\n"
 "       -V = print better ASCII picture for each solution\n"
 "       -l = print list of tiles for each solution\n"
 "\n"
 "       -c = suppress count of solutions\n"
+"       -e = first eliminate placements that are in no solution\n"
 "       -n = print only first N solutions\n"
 "       -1 = same as -n1\n"
 "       -i = left indent\n"
+"       -j = search on N threads (0 = one per processor)\n"
 "       -r = don't suppress rotations and reflections\n"
 "       -R = don't reverse tiles\n"
 "       -s = print extra spaces for alignment in -l output\n"
 "       -u = use reversed name for reversed tiles in -v output\n"
 "       -W = size of -V cells\n"
+"       -z = only count solutions, including rotations and reflections,\n"
+"            with a memoized search, which wins when many placements\n"
+"            leave the same region to fill (such as on 3xN boards) but\n"
+"            can be slower than enumerating elsewhere\n"
+"       --dump-matrix = save the placement matrix to FILE\n"
+"       --load-matrix = read the placement matrix from FILE instead of\n"
+"            building it (same tiles and board as when it was saved)\n"
+"       --stats = print statistics of the search on stderr as JSON\n"
+"            (not with -z)\n"
+"       --estimate = only estimate the size of the search from N random\n"
+"            probes, to budget a long run\n"
+"       --progress = report the fraction of the search tree explored on\n"
+"            stderr every few million nodes (not with -j)\n"
+"       --split = only split the search into at least N jobs, written to\n"
+"            files job.0, job.1, ... (not with identical tiles)\n"
+"       --job = solve just the part of the search in a FILE from --split,\n"
+"            given the same options; merge-jobs adds up the counts\n"
+"       --checkpoint = save the position of the search in FILE every few\n"
+"            million nodes, and if FILE is there, resume from it (not with\n"
+"            -j or identical tiles)\n"
 "\n"
 "       -p = use pentomino tiles\n"
 "       -x = use hexomino tiles\n"
@@ -64,6 +89,9 @@ char help2[] = {
 "If there is no slash, the reversed name is the tile's name with the\n"
 "case of the first letter inverted.\n"
 "\n"
+"A tile may be listed several times to use several copies of it.\n"
+"Copies are interchangeable, so swapping them does not give a new solution.\n"
+"\n"
 "For example, this tile file describes two pentominoes:\n"
 "    tile F\n"
 "    .**\n"